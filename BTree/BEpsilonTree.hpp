@@ -0,0 +1,575 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+
+/*
+	Node of B-epsilon tree.
+	Leaf keeps keys of set(increasing sequence).
+	Internal node keeps pivots and children: child i has keys k with
+		pivots[i - 1] <= k < pivots[i], and buffer of messages which were not yet
+		delivered to its children(one, the newest, message for every key).
+	keys, children and buffer are allocated from memory resource of tree.
+*/
+template<typename Key>
+class BEpsilonNode
+{
+public:
+	enum class Message { Insert, Erase };
+	typedef std::pmr::vector<Key> Keys;
+	typedef std::shared_ptr<BEpsilonNode<Key>> pChild;
+	typedef std::pmr::vector<pChild> Children;
+	typedef std::pmr::map<Key, Message> Buffer;
+
+	explicit BEpsilonNode(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: leaf{ false }, keys(resource), children(resource), buffer(resource) {}
+
+	// index of child which key belongs to
+	inline int childIndex(const Key& key) const { return std::upper_bound(keys.begin(), keys.end(), key) - keys.begin(); }
+	inline int size() const { return keys.size(); }
+
+	bool leaf;
+	Keys keys;
+	Children children;
+	Buffer buffer;
+};
+
+/*
+	Bytes taken by tree(see BEpsilonTree::memoryUsage):
+		nodeBytes - node objects with their shared_ptr control blocks(size of control block is estimated),
+		keyBytes, childBytes - used parts of keys and children arrays,
+		bufferBytes - messages in buffers(size of map node is estimated),
+		slackBytes - reserved but not used parts of arrays.
+*/
+struct BEpsilonMemoryUsage
+{
+	size_t nodes;
+	size_t nodeBytes;
+	size_t keyBytes;
+	size_t childBytes;
+	size_t bufferBytes;
+	size_t slackBytes;
+	inline size_t total() const { return nodeBytes + keyBytes + childBytes + bufferBytes + slackBytes; }
+};
+
+/*
+	Write-optimized variant of BTree(B-epsilon tree).
+	insert/erase do not go to leaf: they put message to root's buffer and return.
+	When buffer of node has more than bufferCapacity messages, messages of the child
+		which has the most of them are moved to this child in one batch
+		(applied to keys, if child is leaf), so one node write delivers many messages
+		and every message is written only O(log n) times on the whole way down.
+	contains goes down as in BTree, but the first message for key on the way
+		(it is the newest one) answers the query.
+	Nodes are kept as in BTree: t - 1...2t - 1 keys in leaves, t...2t children in internal
+		nodes(except root), they are split and joined after batches are applied.
+	Tree keeps set of keys, so upsert is the same as insert here.
+	All nodes(with shared_ptr control blocks, arrays and buffers) are allocated
+		from memory resource given on construction, default one is new/delete.
+*/
+template<typename Key>
+class BEpsilonTree
+{
+	typedef BEpsilonNode<Key> Node;
+	typedef std::shared_ptr<Node> pNode;
+	typedef typename Node::Message Message;
+	typedef typename Node::Buffer Buffer;
+public:
+	// bufferCapacity 0 means (2t)^2 - node with buffer is about 2t times bigger than leaf
+	BEpsilonTree(int _minDegree, size_t _bufferCapacity = 0, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	bool contains(Key key) const;
+	void insert(Key key);
+	void erase(Key key);
+	// delivers all messages to leaves
+	void flushAll();
+	BEpsilonMemoryUsage memoryUsage() const;
+	// gives back spare capacity of keys and children arrays of all nodes
+	void shrinkToFit();
+	inline std::pmr::memory_resource* getResource() const { return resource; }
+private:
+	void put(Key key, Message message);
+	void flush(pNode node);
+	void flushChild(pNode node, int i);
+	void flushSubtree(pNode node);
+	bool hasMessages(pNode node) const;
+	void applyToLeaf(pNode leaf, typename Buffer::iterator first, typename Buffer::iterator last);
+	bool fixChild(pNode node, int i);
+	void fixChildren(pNode node);
+	void splitChild(pNode node, int i);
+	void joinChildren(pNode node, int i);
+	void fixRoot();
+	pNode allocateNode();
+	int diskRead(pNode node) const;
+	int diskWrite(pNode node);
+	template<typename Function>
+	void forEachNode(pNode node, Function f) const;
+	int minDegree;
+	size_t bufferCapacity;
+	pNode root;
+	std::pmr::memory_resource* resource;
+};
+
+template<typename Key>
+BEpsilonTree<Key>::BEpsilonTree(int _minDegree, size_t _bufferCapacity, std::pmr::memory_resource* _resource)
+	: minDegree{ _minDegree }, bufferCapacity{ _bufferCapacity ? _bufferCapacity : size_t(4 * _minDegree * _minDegree) },
+	resource{ _resource }
+{
+	root = allocateNode();
+	root->leaf = true;
+	diskWrite(root);
+}
+
+template<typename Key>
+bool BEpsilonTree<Key>::contains(Key key) const
+{
+	pNode curNode = root;
+	diskRead(curNode);
+	while (!curNode->leaf)
+	{
+		// newest message for key is the highest one
+		auto message = curNode->buffer.find(key);
+		if (message != curNode->buffer.end())
+		{
+			return message->second == Message::Insert;
+		}
+		curNode = curNode->children[curNode->childIndex(key)];
+		diskRead(curNode);
+	}
+	return std::binary_search(curNode->keys.begin(), curNode->keys.end(), key);
+}
+
+template<typename Key>
+void BEpsilonTree<Key>::insert(Key key)
+{
+	put(key, Message::Insert);
+}
+
+template<typename Key>
+void BEpsilonTree<Key>::erase(Key key)
+{
+	put(key, Message::Erase);
+}
+
+template<typename Key>
+void BEpsilonTree<Key>::flushAll()
+{
+	// joins during flushing can bring messages to already flushed nodes, so going again
+	while (hasMessages(root))
+	{
+		flushSubtree(root);
+		fixRoot();
+	}
+}
+
+/*
+	Root which is leaf takes message right away, else message waits in root's buffer.
+*/
+template<typename Key>
+void BEpsilonTree<Key>::put(Key key, Message message)
+{
+	Buffer single(resource);
+	single.emplace(key, message);
+	if (root->leaf)
+	{
+		applyToLeaf(root, single.begin(), single.end());
+	}
+	else
+	{
+		// newer message replaces older one
+		root->buffer[key] = message;
+		diskWrite(root);
+		if (root->buffer.size() > bufferCapacity)
+		{
+			flush(root);
+		}
+	}
+	fixRoot();
+}
+
+/*
+	Moves batches down while buffer is too big:
+		every batch is all messages of one child(the one with most of them).
+*/
+template<typename Key>
+void BEpsilonTree<Key>::flush(pNode node)
+{
+	while (node->buffer.size() > bufferCapacity)
+	{
+		int best = 0;
+		size_t bestCount = 0;
+		for (int i = 0; i <= node->size(); ++i)
+		{
+			auto first = (i == 0) ? node->buffer.begin() : node->buffer.lower_bound(node->keys[i - 1]);
+			auto last = (i == node->size()) ? node->buffer.end() : node->buffer.lower_bound(node->keys[i]);
+			size_t count = std::distance(first, last);
+			if (count > bestCount)
+			{
+				best = i;
+				bestCount = count;
+			}
+		}
+		flushChild(node, best);
+	}
+}
+
+/*
+	Moves all messages of child i to it and fixes child's size after that.
+*/
+template<typename Key>
+void BEpsilonTree<Key>::flushChild(pNode node, int i)
+{
+	auto first = (i == 0) ? node->buffer.begin() : node->buffer.lower_bound(node->keys[i - 1]);
+	auto last = (i == node->size()) ? node->buffer.end() : node->buffer.lower_bound(node->keys[i]);
+	if (first == last)
+	{
+		return;
+	}
+	pNode child = node->children[i];
+	diskRead(child);
+	if (child->leaf)
+	{
+		applyToLeaf(child, first, last);
+	}
+	else
+	{
+		for (auto message = first; message != last; ++message)
+		{
+			child->buffer[message->first] = message->second;
+		}
+		diskWrite(child);
+		if (child->buffer.size() > bufferCapacity)
+		{
+			flush(child);
+		}
+	}
+	node->buffer.erase(first, last);
+	fixChild(node, i);
+	diskWrite(node);
+}
+
+/*
+	Empties buffers of node and all its subtree top-down.
+*/
+template<typename Key>
+void BEpsilonTree<Key>::flushSubtree(pNode node)
+{
+	if (node->leaf)
+	{
+		return;
+	}
+	while (!node->buffer.empty())
+	{
+		flushChild(node, node->childIndex(node->buffer.begin()->first));
+	}
+	for (int i = 0; i < (int)node->children.size(); ++i)
+	{
+		flushSubtree(node->children[i]);
+		fixChild(node, i);
+	}
+}
+
+template<typename Key>
+bool BEpsilonTree<Key>::hasMessages(pNode node) const
+{
+	if (node->leaf)
+	{
+		return false;
+	}
+	if (!node->buffer.empty())
+	{
+		return true;
+	}
+	for (const pNode& child : node->children)
+	{
+		if (hasMessages(child))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+	Merges sorted keys of leaf with sorted messages in one pass.
+*/
+template<typename Key>
+void BEpsilonTree<Key>::applyToLeaf(pNode leaf, typename Buffer::iterator first, typename Buffer::iterator last)
+{
+	typename Node::Keys merged(resource);
+	merged.reserve(leaf->keys.size() + std::distance(first, last));
+	auto key = leaf->keys.begin();
+	for (; first != last; ++first)
+	{
+		while (key != leaf->keys.end() && *key < first->first)
+		{
+			merged.push_back(*key++);
+		}
+		// existing key is replaced by message: kept for Insert, dropped for Erase
+		if (key != leaf->keys.end() && !(first->first < *key))
+		{
+			++key;
+		}
+		if (first->second == Message::Insert)
+		{
+			merged.push_back(first->first);
+		}
+	}
+	merged.insert(merged.end(), key, leaf->keys.end());
+	leaf->keys = std::move(merged);
+	diskWrite(leaf);
+}
+
+/*
+	After batch child i can be too big(split) or too small(joined with sibling).
+	Returns true if child was changed.
+*/
+template<typename Key>
+bool BEpsilonTree<Key>::fixChild(pNode node, int i)
+{
+	pNode child = node->children[i];
+	int t = minDegree;
+	if (child->leaf ? child->size() > 2 * t - 1 : child->size() + 1 > 2 * t)
+	{
+		splitChild(node, i);
+		return true;
+	}
+	// node with one child can not join it with anything, its parent fixes it later
+	if ((child->leaf ? child->size() < t - 1 : child->size() + 1 < t) && node->size() > 0)
+	{
+		// joining with right sibling, or with left one for the last child
+		joinChildren(node, (i < node->size()) ? i : i - 1);
+		return true;
+	}
+	return false;
+}
+
+/*
+	Node which had only one child could leave it too small(see fixChild),
+		so all children of node are checked once node has siblings of them.
+*/
+template<typename Key>
+void BEpsilonTree<Key>::fixChildren(pNode node)
+{
+	bool changed = true;
+	while (changed && !node->leaf)
+	{
+		changed = false;
+		for (int i = 0; i < (int)node->children.size(); ++i)
+		{
+			changed = fixChild(node, i) || changed;
+		}
+	}
+}
+
+/*
+	Splits child i to as many parts as needed, every part gets
+		t - 1...2t - 1 keys(leaf) or t...2t children(internal node).
+	For leaves first key of every next part is copied to parent as pivot,
+		for internal nodes pivot between parts goes up and messages are split by pivots.
+*/
+template<typename Key>
+void BEpsilonTree<Key>::splitChild(pNode node, int i)
+{
+	pNode child = node->children[i];
+	int t = minDegree;
+	typename Node::Keys keys = std::move(child->keys);
+	typename Node::Children children = std::move(child->children);
+	Buffer buffer = std::move(child->buffer);
+	child->keys.clear();
+	child->children.clear();
+	child->buffer.clear();
+	// items are keys for leaf and children for internal node
+	size_t items = child->leaf ? keys.size() : children.size();
+	size_t maxItems = child->leaf ? 2 * t - 1 : 2 * t;
+	size_t parts = (items + maxItems - 1) / maxItems;
+	std::vector<pNode> newNodes;
+	std::vector<Key> pivots;
+	size_t start = 0;
+	for (size_t p = 0; p < parts; ++p)
+	{
+		size_t end = items * (p + 1) / parts;
+		// old node keeps the first part
+		pNode part = (p == 0) ? child : allocateNode();
+		part->leaf = child->leaf;
+		if (child->leaf)
+		{
+			if (p > 0)
+			{
+				pivots.push_back(keys[start]);
+			}
+			part->keys.assign(keys.begin() + start, keys.begin() + end);
+		}
+		else
+		{
+			if (p > 0)
+			{
+				pivots.push_back(keys[start - 1]);
+			}
+			part->keys.assign(keys.begin() + start, keys.begin() + (end - 1));
+			part->children.assign(children.begin() + start, children.begin() + end);
+			auto first = (p == 0) ? buffer.begin() : buffer.lower_bound(keys[start - 1]);
+			auto last = (p + 1 == parts) ? buffer.end() : buffer.lower_bound(keys[end - 1]);
+			part->buffer.insert(first, last);
+		}
+		newNodes.push_back(part);
+		start = end;
+	}
+	node->keys.insert(node->keys.begin() + i, pivots.begin(), pivots.end());
+	node->children.insert(node->children.begin() + i + 1, newNodes.begin() + 1, newNodes.end());
+	for (pNode& part : newNodes)
+	{
+		diskWrite(part);
+	}
+	diskWrite(node);
+}
+
+/*
+	Joins children i and i + 1(with pivot between them for internal nodes),
+		and splits result again if it is too big.
+*/
+template<typename Key>
+void BEpsilonTree<Key>::joinChildren(pNode node, int i)
+{
+	pNode left = node->children[i];
+	pNode right = node->children[i + 1];
+	diskRead(left);
+	diskRead(right);
+	if (!left->leaf)
+	{
+		left->keys.push_back(node->keys[i]);
+		left->children.insert(left->children.end(), right->children.begin(), right->children.end());
+		left->buffer.insert(right->buffer.begin(), right->buffer.end());
+	}
+	left->keys.insert(left->keys.end(), right->keys.begin(), right->keys.end());
+	node->keys.erase(node->keys.begin() + i);
+	node->children.erase(node->children.begin() + i + 1);
+	fixChildren(left);
+	diskWrite(left);
+	diskWrite(node);
+	int t = minDegree;
+	if (left->leaf ? left->size() > 2 * t - 1 : left->size() + 1 > 2 * t)
+	{
+		splitChild(node, i);
+	}
+}
+
+/*
+	Root which is too big gets new parent, root with one child is replaced by this child
+		(its buffer goes down, it is the newest one).
+*/
+template<typename Key>
+void BEpsilonTree<Key>::fixRoot()
+{
+	int t = minDegree;
+	while (root->leaf ? root->size() > 2 * t - 1 : root->size() + 1 > 2 * t)
+	{
+		pNode newRoot = allocateNode();
+		newRoot->children.push_back(root);
+		root = newRoot;
+		splitChild(root, 0);
+	}
+	while (!root->leaf && root->size() == 0)
+	{
+		pNode child = root->children[0];
+		Buffer messages = std::move(root->buffer);
+		root = child;
+		if (root->leaf)
+		{
+			applyToLeaf(root, messages.begin(), messages.end());
+		}
+		else
+		{
+			for (auto& message : messages)
+			{
+				root->buffer[message.first] = message.second;
+			}
+			if (root->buffer.size() > bufferCapacity)
+			{
+				flush(root);
+			}
+		}
+		fixChildren(root);
+		// root could become too big again after taking messages
+		while (root->leaf ? root->size() > 2 * t - 1 : root->size() + 1 > 2 * t)
+		{
+			pNode newRoot = allocateNode();
+			newRoot->children.push_back(root);
+			root = newRoot;
+			splitChild(root, 0);
+		}
+	}
+}
+
+/*
+	Allocates node and page on disk for this node.
+	NOW allocates only in memory.
+*/
+template<typename Key>
+typename BEpsilonTree<Key>::pNode BEpsilonTree<Key>::allocateNode()
+{
+	return std::allocate_shared<Node>(std::pmr::polymorphic_allocator<Node>(resource), resource);
+}
+
+/*
+	Reading contents of node from disk.
+	NOW it makes nothing.
+	Returns error code, or 0 on success.
+*/
+template<typename Key>
+int BEpsilonTree<Key>::diskRead(pNode node) const
+{
+	return 0;
+}
+
+template<typename Key>
+int BEpsilonTree<Key>::diskWrite(pNode node)
+{
+	return 0;
+}
+
+template<typename Key>
+template<typename Function>
+void BEpsilonTree<Key>::forEachNode(pNode node, Function f) const
+{
+	diskRead(node);
+	f(node);
+	for (const pNode& child : node->children)
+	{
+		forEachNode(child, f);
+	}
+}
+
+template<typename Key>
+BEpsilonMemoryUsage BEpsilonTree<Key>::memoryUsage() const
+{
+	// control block of allocate_shared: vtable pointer, two counters and allocator
+	const size_t controlBlockBytes = sizeof(void*) + 2 * sizeof(int) + sizeof(std::pmr::polymorphic_allocator<char>);
+	// map node: color, parent and two children with message
+	const size_t messageBytes = 4 * sizeof(void*) + sizeof(typename Buffer::value_type);
+	BEpsilonMemoryUsage usage{ 0, 0, 0, 0, 0, 0 };
+	forEachNode(root, [&usage, controlBlockBytes, messageBytes](pNode node)
+	{
+		++usage.nodes;
+		usage.nodeBytes += sizeof(Node) + controlBlockBytes;
+		usage.keyBytes += node->keys.size() * sizeof(Key);
+		usage.childBytes += node->children.size() * sizeof(pNode);
+		usage.bufferBytes += node->buffer.size() * messageBytes;
+		usage.slackBytes += (node->keys.capacity() - node->keys.size()) * sizeof(Key)
+			+ (node->children.capacity() - node->children.size()) * sizeof(pNode);
+	});
+	return usage;
+}
+
+template<typename Key>
+void BEpsilonTree<Key>::shrinkToFit()
+{
+	forEachNode(root, [this](pNode node)
+	{
+		node->keys.shrink_to_fit();
+		node->children.shrink_to_fit();
+		diskWrite(node);
+	});
+}
@@ -1,541 +1,1456 @@
-#pragma once
-#include <vector>
-#include <list>
-#include <memory>
-
-/*
-	Node of B-Tree.
-	Has such invariants:
-		1. keys - increasing sequence;
-		2. for every ki in keys vector:
-			childer.ki <= this->keys[i];
-		3. all leaves have the same height;
-*/
-template<typename Key>
-class BTreeNode
-{
-public:
-	typedef std::vector<Key> Keys;
-	typedef std::shared_ptr<BTreeNode<Key>> pChild;
-	typedef std::vector<pChild> Children;
-
-	BTreeNode()
-		: leaf{ false } {}
-
-	inline void appendKey(Key k) { keys.push_back(k); }
-	inline void prependKey(Key k) { keys.insert(keys.begin(), k); }
-	inline void insertKey(int i, Key k) { keys.insert(keys.begin() + i, k); }
-	inline auto findKey(Key k) { return std::find(keys.begin(), keys.end(), k); }
-	// we have min keys = t - 1 and min children = t
-	inline void resizeKeysAndChildren(int sz) { keys.resize(sz); children.resize(sz + 1); }
-	inline Key& operator[](int i) { return keys[i]; }
-	inline void eraseKey(int i) { keys.erase(keys.begin() + i); }
-	inline pChild getChild(int i) const { return children[i]; }
-	inline void setChild(int i, pChild ch) { children[i] = ch; }
-	inline void appendChild(pChild ch) { children.push_back(ch); }
-	inline void prependChild(pChild ch) { children.insert(children.begin(), ch); }
-	inline void insertChild(int i, pChild ch) { children.insert(children.begin() + i, ch); }
-	inline void eraseChild(int i) { children.erase(children.begin() + i); }
-	inline int size() const { return keys.size(); }
-
-	bool leaf;
-
-private:
-	Keys keys;
-	Children children;
-};
-
-/*
-	minDegree - minimal degree('t' in Cormen's book and later)
-	We have such rules(ci = number of children for each node, ki = number of keys for each node):
-		1. t <= ci <= 2t
-		2. t-1 <= ki <= 2t-1
-*/
-template<typename Key>
-class BTree
-{
-	typedef std::shared_ptr<BTreeNode<Key>> pNode;
-	typedef std::pair<pNode, int> NodeIndexPair;
-	typedef std::shared_ptr<NodeIndexPair> pNodeIndexPair;
-public:
-	BTree(int _minDegree);
-	pNodeIndexPair search(Key key);
-	void insert(Key key);
-	void erase(Key key);
-	pNode predecessor(pNode node, int keyIndex);
-	pNode successor(pNode node, int keyIndex);
-private:
-	pNodeIndexPair _search(pNode searchNode, Key key);
-	void _erase(pNode startNode, Key key);
-	void insertNonfull(pNode node, Key key);
-	void splitChild(pNode node, int i);
-	pNode allocateNode();
-	int normalizeNodeForErasing(pNode parentNode, int i);
-	pNode unionNodesAroundKey(pNode left, Key key, pNode right);
-	int diskRead(pNode node);
-	int diskWrite(pNode node);
-	int minDegree;
-	pNode root;
-};
-
-template<typename Key>
-BTree<Key>::BTree(int _minDegree)
-	: minDegree{_minDegree}
-{
-	root = allocateNode();
-	root->leaf = true;
-	diskWrite(root);
-}
-
-/*
-	Wraps private search with root as first arg.
-*/
-template<typename Key>
-typename BTree<Key>::pNodeIndexPair BTree<Key>::search(Key key)
-{
-	return _search(root, key);
-}
-
-template<typename Key>
-void BTree<Key>::insert(Key key)
-{
-	pNode curNode = root;
-	// no space in root - need to do splitting and to make new root
-	if (curNode->size() == (2 * minDegree - 1))
-	{
-		pNode newParent = allocateNode();
-		root = newParent;
-		newParent->leaf = false;
-		newParent->appendChild(curNode);
-		splitChild(newParent, 0);
-		insertNonfull(newParent, key);
-	}
-	// enough space
-	else
-	{
-		insertNonfull(curNode, key);
-	}
-}
-
-template<typename Key>
-void BTree<Key>::erase(Key key)
-{
-	if (root->size() == 0)	// empty tree
-	{
-		return;
-	}
-	_erase(root, key);
-}
-
-
-/*
-	predecessor - rightmost ancestor of left sibling of 'node''s key with keyIndex
-*/
-template<typename Key>
-typename BTree<Key>::pNode BTree<Key>::predecessor(pNode node, int keyIndex)
-{
-	pNode curNode = node->getChild(keyIndex);
-	while (!curNode->leaf)
-	{
-		curNode = curNode->getChild(curNode->size());
-		diskRead(curNode);
-	}
-	return curNode;
-}
-
-/*
-	successor - leftmost ancestor of right sibling of 'node''s key with keyIndex
-*/
-template<typename Key>
-typename BTree<Key>::pNode BTree<Key>::successor(pNode node, int keyIndex)
-{
-	pNode curNode = node->getChild(keyIndex + 1);
-	while (!curNode->leaf)
-	{
-		curNode = curNode->getChild(0);
-		diskRead(curNode);
-	}
-	return curNode;
-}
-
-/*
-	Private version of search in B-Tree.
-	For searching in full tree, call with root as first arg.
-*/
-template<typename Key>
-typename BTree<Key>::pNodeIndexPair BTree<Key>::_search(pNode searchNode, Key key)
-{
-	int i = 0;
-	// checking this node keys
-	while (i < searchNode->size() && key > (*searchNode)[i])
-	{
-		++i;
-	}
-	// found one
-	if (i < searchNode->size() && key == (*searchNode)[i])
-	{
-		NodeIndexPair nodeIndexPair = std::make_pair(searchNode, i);
-		return std::make_shared<NodeIndexPair>(nodeIndexPair);
-	}
-	// not found and leaf
-	else if (searchNode->leaf)
-	{
-		return nullptr;
-	}
-	// continue searching
-	else
-	{
-		return _search(searchNode->getChild(i), key);
-	}
-}
-
-/*
-	Main function of erasing.
-	startNode is hint where to start deleting
-*/
-template<typename Key>
-void BTree<Key>::_erase(pNode startNode, Key key)
-{
-	// finding needed key or child where it should be
-	pNode curNode = startNode;
-	diskRead(curNode);
-	int keyIndex = -1;
-	do
-	{
-		bool found = false;
-		pNode foundNode = nullptr;
-		for (int i = 0; i < curNode->size(); ++i)
-		{
-			if ((*curNode)[i] == key)
-			{
-				keyIndex = i;
-				found = true;
-				foundNode = curNode;
-				break;
-			}
-			else if ((*curNode)[i] > key)
-			{
-				// normalizing node for further traversing
-				int deviation = normalizeNodeForErasing(curNode, i);
-				i -= deviation;	// bad but as it is
-				// traversing node is not changing after normalization(of course)
-				curNode = curNode->getChild(i);
-				diskRead(curNode);
-				foundNode = curNode;
-				break;
-			}
-		}
-		// if not found - getting rightmost child of current node
-		if (!foundNode) curNode = curNode->getChild(curNode->size());
-		if (found)
-		{
-			break;
-		}
-	} while (!curNode->leaf);
-
-	// case 1: node is leaf - simply erasing node
-	if (curNode->leaf)
-	{
-		// searching for the last time - in leaf
-		for (int i = 0; i < curNode->size(); ++i)
-		{
-			if ((*curNode)[i] == key)
-			{
-				keyIndex = i;
-				break;
-			}
-		}
-		if (keyIndex != -1)
-		{ 
-			curNode->eraseKey(keyIndex);
-			curNode->resizeKeysAndChildren(curNode->size());
-			diskWrite(curNode);
-		}
-		return;
-	}
-	// case 2: 
-	pNode leftNode = curNode->getChild(keyIndex);
-	pNode rightNode = curNode->getChild(keyIndex + 1);
-	diskRead(leftNode);
-	diskRead(rightNode);
-	// 2.a - prior child has t or more keys
-	if (leftNode->size() >= minDegree)
-	{
-		pNode predecessorNode = predecessor(curNode, keyIndex);
-		// size - 1 because predecessor is always rightmost child
-		Key swapKey = (*predecessorNode)[predecessorNode->size() - 1];
-		_erase(predecessorNode, swapKey);
-		diskWrite(predecessorNode);
-		(*curNode)[keyIndex] = swapKey;
-	}
-	// 2.b - next child has t or more keys
-	else if (rightNode->size() >= minDegree)
-	{
-		pNode successorNode = successor(curNode, keyIndex);
-		// 0 because successor is always leftmost child
-		Key swapKey = (*successorNode)[0];
-		_erase(successorNode ,swapKey);
-		diskWrite(successorNode);
-		(*curNode)[keyIndex] = swapKey;
-	}
-	// 2.c - both prior and next children have t - 1 keys
-	else
-	{
-		// 1. filling leftNode with key and rightNode's keys
-		leftNode->appendKey(key);
-		for (int i = 0; i < rightNode->size(); ++i)
-		{
-			leftNode->appendKey((*rightNode)[i]);
-		}
-		// 2. adding both of rightNode's children to the end of leftNode's children
-		leftNode->appendChild(rightNode->getChild(0));
-		leftNode->appendChild(rightNode->getChild(1));
-		// 3. delete from curNode key and pointer to rightNode
-		curNode->eraseKey(keyIndex);
-		curNode->eraseChild(keyIndex + 1);
-		// 4. free rightNode
-		rightNode.reset();
-		// 5. recursively erasing key from leftNode
-		_erase(leftNode, key);
-		diskWrite(leftNode);
-		diskWrite(curNode);
-		diskWrite(rightNode);
-	}
-}
-
-/*
-	Inserting if root is not full - main inserting function.
-*/
-template<typename Key>
-void BTree<Key>::insertNonfull(pNode node, Key key)
-{
-	int i = node->size() - 1;
-	// if leaf - simply searching for place to insert and inserting
-	if (node->leaf)
-	{
-		node->resizeKeysAndChildren(node->size() + 1);
-		// moving elements to right
-		while (i >= 0 && key < (*node)[i])
-		{
-			(*node)[i + 1] = (*node)[i];
-			--i;
-		}
-		(*node)[i + 1] = key;
-		diskWrite(node);
-	}
-	// else - recursively going by tree, and sometimes, if needed,
-	//		splitting it
-	else
-	{
-		while (i >= 0 && key < (*node)[i]) { --i; }
-		++i;
-		// filling contents of i'th child of node
-		diskRead(node->getChild(i));
-		if (node->getChild(i)->size() == (2 * minDegree - 1))
-		{
-			splitChild(node, i);
-			if (key > (*node)[i]) { ++i; }
-		}
-		insertNonfull(node->getChild(i), key);
-	}
-}
-
-/*===================================================================
-	   ------------					 -------------
-	   |....N,W...|					 |... N S W..|
-	   ------------					 -------------
-			|			------>			  /  \
-			|							 /    \
-	------------------				--------- ---------
-	|P Q R S T U V   |				| P Q R | | T U V |
-	-----------------				--------- ---------
-	
-	splits full node as on illustration
-	median goes to parent
-	two children are splitted and now have t-1 elements each(before splitting
-		node had 2t-1)
-	if parent is also full, doing recursively
-
-	Node x is splitted to two nodes - y and z
-======================================================================
-*/
-template<typename Key>
-void BTree<Key>::splitChild(pNode x, int i)
-{
-	int t = minDegree;
-	pNode z = allocateNode();
-	pNode y = x->getChild(i);
-	z->leaf = y->leaf;
-	z->resizeKeysAndChildren(t - 1);
-	// moving first (t - 1) nodes of y to z
-	for (int j = 0; j < (t - 1); ++j)
-	{
-		(*z)[j] = (*y)[j + t];
-	}
-	// setting z child
-	if (!(y->leaf))
-	{
-		for (int j = 0; j < t; ++j)
-		{
-			z->setChild(j, y->getChild(j + t));
-		}
-	}
-	Key keyGoingUp = (*y)[t - 1];
-	y->resizeKeysAndChildren(t - 1);
-	x->resizeKeysAndChildren(x->size() + 1);
-	// moving x children after i + 1 to right
-	for (int j = x->size() - 1; j >= i + 1; --j)
-	{
-		x->setChild(j + 1, x->getChild(j));
-	}
-	// inserting z - new child of x
-	x->setChild(i + 1, z);
-	for (int j = x->size() - 2; j >= i; --j)
-	{
-		(*x)[j + 1] = (*x)[j];
-	}
-	// inserting new key
-	(*x)[i] = keyGoingUp;
-	diskWrite(y);
-	diskWrite(z);
-	diskWrite(x);
-}
-
-/*
-	Allocates node and page on disk for this node.
-	NOW allocates only in memory.
-*/
-template<typename Key>
-typename BTree<Key>::pNode BTree<Key>::allocateNode()
-{
-	pNode newNode = std::make_shared<BTreeNode<Key>>(BTreeNode<Key>());
-	return newNode;
-}
-
-/*
-	When erasing from B-Tree and traversing to next node,
-	we should be sure that it has at least t(minDegree) keys.
-	We can have 3 cases.
-	Returns number for how many childIndex has changed(it can be 1 in 1 case, almost everytime it is 0).
-*/
-template<typename Key>
-int BTree<Key>::normalizeNodeForErasing(pNode parentNode, int childIndex)
-{
-	int deviation = 0;
-	// case 1: all right - node has t or more keys
-	if (parentNode->getChild(childIndex)->size() >= minDegree)
-	{
-		return 0;
-	}
-	int keyIndex = (childIndex == 0) ? 0 : childIndex - 1;
-	pNode normalizingNode = parentNode->getChild(childIndex);
-	pNode leftNode =  parentNode->getChild(childIndex - 1);
-	pNode rightNode = parentNode->getChild(childIndex + 1);
-	diskRead(normalizingNode);
-	diskRead(leftNode);
-	diskRead(rightNode);
-	/*
-	case 2: left or right sibling has t or more keys:
-		in this case we are inserting parent-key for normalizing node and sibling in norm node,
-		then taking one(closest) key from this sibling and placing it as this parent's key,
-		and updating parent's children vector.
-	*/
-	// 2.1. left sibling
-	if (leftNode && leftNode->size() >= minDegree)
-	{
-		Key movingKey = (*parentNode)[keyIndex];
-		parentNode->eraseKey(keyIndex);
-		normalizingNode->prependKey(movingKey);
-		movingKey = (*leftNode)[(leftNode->size() - 1)];
-		parentNode->insertKey(keyIndex, movingKey);
-		pNode movingChild = leftNode->getChild(leftNode->size());
-		leftNode->eraseChild(leftNode->size());
-		normalizingNode->prependChild(movingChild);
-		leftNode->eraseKey(leftNode->size() - 1);
-	}
-	// 2.2 right sibling
-	else if (rightNode && rightNode->size() >= minDegree)
-	{
-		Key movingKey = (*parentNode)[keyIndex];
-		parentNode->eraseKey(keyIndex);
-		normalizingNode->appendKey(movingKey);
-		movingKey = (*rightNode)[0];
-		parentNode->insertKey(keyIndex, movingKey);
-		pNode movingChild = rightNode->getChild(0);
-		rightNode->eraseChild(0);
-		normalizingNode->appendChild(movingChild);
-		rightNode->eraseKey(0);
-	}
-	/*
-	case 3: left AND right siblings have t keys.
-		In this case we are joining normalizing node with its sibling(left or right),
-			(left here if presented, else right),
-		and making their key-separator from parentNode this joined node's new median.
-	*/
-	else
-	{
-		pNode unionNode = nullptr;
-		if (leftNode)
-		{
-			unionNode = unionNodesAroundKey(leftNode, (*parentNode)[keyIndex], normalizingNode);
-			// because we have moved key to left
-			deviation = 1;
-		}
-		else // if right node(else leaf and no such case)
-		{
-			unionNode = unionNodesAroundKey(normalizingNode, (*parentNode)[keyIndex], rightNode);
-		}
-		parentNode->eraseKey(keyIndex);
-		parentNode->eraseChild(childIndex);
-		// replacing instead of erasing
-		parentNode->setChild(childIndex - 1, unionNode);
-	}
-	diskWrite(leftNode);
-	diskWrite(rightNode);
-	diskWrite(normalizingNode);
-	diskWrite(parentNode);
-	return deviation;
-}
-
-/*
-	makes node left + right
-	keys become: left.keys + key + right.keys
-	children become: left.children + right.children
-*/
-template<typename Key>
-typename BTree<Key>::pNode BTree<Key>::unionNodesAroundKey(pNode left, Key key, pNode right)
-{
-	pNode unionNode = allocateNode();
-	unionNode->leaf = left->leaf && right->leaf;
-	for (int j = 0; j < left->size(); ++j)
-	{
-		unionNode->appendKey((*left)[j]);
-		unionNode->appendChild(left->getChild(j));
-	}
-	unionNode->appendChild(left->getChild(left->size()));
-	unionNode->appendKey(key);
-	for (int j = 0; j < right->size(); ++j)
-	{
-		unionNode->appendKey((*right)[j]);
-		unionNode->appendChild(right->getChild(j));
-	}
-	unionNode->appendChild(right->getChild(right->size()));
-	return unionNode;
-}
-
-/*
-	Reading contents of next child node from disk.
-	NOW it makes nothing.
-	Returns error code, or 0 on success.
-*/
-template<typename Key>
-int BTree<Key>::diskRead(pNode node)
-{
-	return 0;
-}
-
-template<typename Key>
-int BTree<Key>::diskWrite(pNode node)
-{
-	return 0;
+#pragma once
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include "FrozenBTree.hpp"
+#include "Prefetch.hpp"
+
+/*
+	Bytes taken by tree(see BTree::memoryUsage):
+		nodeBytes - node objects with their shared_ptr control blocks(size of control block is estimated),
+		keyBytes, childBytes - used parts of keys and children arrays,
+		slackBytes - reserved but not used parts of these arrays.
+*/
+struct BTreeMemoryUsage
+{
+	size_t nodes;
+	size_t nodeBytes;
+	size_t keyBytes;
+	size_t childBytes;
+	size_t slackBytes;
+	inline size_t total() const { return nodeBytes + keyBytes + childBytes + slackBytes; }
+};
+
+//----BTreeWorkers
+
+/*
+	Threads shared by all trees for searchAsync, started on first use and alive until exit.
+	Tasks are taken in order of submit, task must not throw(packaged_task keeps its exception).
+*/
+class BTreeWorkers
+{
+public:
+	static BTreeWorkers& instance()
+	{
+		static BTreeWorkers workers(std::max(1u, std::thread::hardware_concurrency()));
+		return workers;
+	}
+	BTreeWorkers(const BTreeWorkers&) = delete;
+	BTreeWorkers& operator=(const BTreeWorkers&) = delete;
+	~BTreeWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		taskReady.notify_all();
+		for (std::thread& worker : threads)
+		{
+			worker.join();
+		}
+	}
+	void submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		taskReady.notify_one();
+	}
+private:
+	explicit BTreeWorkers(unsigned count)
+		: stopping{ false }
+	{
+		for (unsigned i = 0; i < count; ++i)
+		{
+			threads.emplace_back(&BTreeWorkers::loop, this);
+		}
+	}
+	void loop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+			{
+				return;
+			}
+			std::function<void()> task = std::move(tasks.front());
+			tasks.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable taskReady;
+	std::deque<std::function<void()>> tasks;
+	bool stopping;
+	std::vector<std::thread> threads;
+};
+
+//----/BTreeWorkers
+
+/*
+	Node of B-Tree.
+	Has such invariants:
+		1. keys - increasing sequence;
+		2. for every ki in keys vector:
+			childer.ki <= this->keys[i];
+		3. all leaves have the same height;
+	subtreeKeys - number of keys in subtree of this node(with its own keys),
+		it is kept by every operation of BTree which moves keys.
+	keys and children arrays are allocated from memory resource of tree.
+*/
+template<typename Key>
+class BTreeNode
+{
+public:
+	typedef std::pmr::vector<Key> Keys;
+	typedef std::shared_ptr<BTreeNode<Key>> pChild;
+	typedef std::pmr::vector<pChild> Children;
+
+	explicit BTreeNode(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: leaf{ false }, subtreeKeys{ 0 }, keys(resource), children(resource) {}
+
+	inline void appendKey(Key k) { keys.push_back(k); }
+	inline void prependKey(Key k) { keys.insert(keys.begin(), k); }
+	inline void insertKey(int i, Key k) { keys.insert(keys.begin() + i, k); }
+	inline auto findKey(Key k) { return std::find(keys.begin(), keys.end(), k); }
+	// we have min keys = t - 1 and min children = t
+	inline void resizeKeysAndChildren(int sz) { keys.resize(sz); children.resize(sz + 1); }
+	inline Key& operator[](int i) { return keys[i]; }
+	inline const Key* keysData() const { return keys.data(); }
+	inline const Key& operator[](int i) const { return keys[i]; }
+	inline void eraseKey(int i) { keys.erase(keys.begin() + i); }
+	inline pChild getChild(int i) const { return children[i]; }
+	inline void setChild(int i, pChild ch) { children[i] = ch; }
+	inline void appendChild(pChild ch) { children.push_back(ch); }
+	inline void prependChild(pChild ch) { children.insert(children.begin(), ch); }
+	inline void insertChild(int i, pChild ch) { children.insert(children.begin() + i, ch); }
+	inline void eraseChild(int i) { children.erase(children.begin() + i); }
+	inline int size() const { return keys.size(); }
+	void addMemoryUsage(BTreeMemoryUsage& usage) const;
+	inline void shrinkToFit() { keys.shrink_to_fit(); children.shrink_to_fit(); }
+
+	bool leaf;
+	size_t subtreeKeys;
+
+private:
+	Keys keys;
+	Children children;
+};
+
+template<typename Key>
+void BTreeNode<Key>::addMemoryUsage(BTreeMemoryUsage& usage) const
+{
+	// control block of allocate_shared: vtable pointer, two counters and allocator
+	const size_t controlBlockBytes = sizeof(void*) + 2 * sizeof(int) + sizeof(std::pmr::polymorphic_allocator<char>);
+	++usage.nodes;
+	usage.nodeBytes += sizeof(BTreeNode<Key>) + controlBlockBytes;
+	usage.keyBytes += keys.size() * sizeof(Key);
+	usage.childBytes += children.size() * sizeof(pChild);
+	usage.slackBytes += (keys.capacity() - keys.size()) * sizeof(Key) + (children.capacity() - children.size()) * sizeof(pChild);
+}
+
+/*
+	minDegree - minimal degree('t' in Cormen's book and later)
+	We have such rules(ci = number of children for each node, ki = number of keys for each node):
+		1. t <= ci <= 2t
+		2. t-1 <= ki <= 2t-1
+	All nodes(with shared_ptr control blocks and key/children arrays) are allocated
+		from memory resource given on construction, default one is new/delete.
+		Parallel fromUnsorted allocates from several threads, so it needs thread-safe
+		resource(as synchronized_pool_resource), or threads = 1.
+*/
+template<typename Key>
+class BTree
+{
+	typedef std::shared_ptr<BTreeNode<Key>> pNode;
+	typedef std::pair<pNode, int> NodeIndexPair;
+	typedef std::shared_ptr<NodeIndexPair> pNodeIndexPair;
+	// root of tree or of its piece with height of it(leaf has height 0)
+	struct Subtree
+	{
+		pNode root;
+		int height;
+	};
+public:
+	BTree(int _minDegree, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	//----bulk building
+	template<typename InputIt>
+	static BTree fromSorted(int _minDegree, InputIt first, InputIt last, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	static BTree fromUnsorted(int _minDegree, std::vector<Key> keys, unsigned threads = std::thread::hardware_concurrency(),
+		std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	//----/bulk building
+	pNodeIndexPair search(Key key);
+	//----batch search(tree must not be changed while it works)
+	std::vector<pNodeIndexPair> searchBatch(const std::vector<Key>& keys, int inFlight = 32);
+	std::future<std::vector<pNodeIndexPair>> searchAsync(std::vector<Key> keys, unsigned threads = std::thread::hardware_concurrency());
+	//----/batch search
+	void insert(Key key);
+	void erase(Key key);
+	pNode predecessor(pNode node, int keyIndex);
+	pNode successor(pNode node, int keyIndex);
+	//----order statistics(O(log n) each)
+	inline size_t size() const { return root->subtreeKeys; }
+	size_t rank(Key key) const;
+	Key select(size_t k) const;
+	size_t countRange(Key lo, Key hi) const;
+	//----/order statistics
+	// read-only copy in one contiguous array(see FrozenBTree), in the same memory resource
+	FrozenBTree<Key> freeze() const;
+	//----split and join(O(height) node operations)
+	BTree split(Key key);
+	static BTree join(BTree& left, BTree& right);
+	//----/split and join
+	//----memory
+	BTreeMemoryUsage memoryUsage() const;
+	// gives back slack of keys and children arrays of all nodes
+	void shrinkToFit();
+	inline std::pmr::memory_resource* getResource() const { return resource; }
+	// same keys in new tree, all its nodes are allocated from _resource
+	BTree clone(std::pmr::memory_resource* _resource) const;
+	//----/memory
+private:
+	pNodeIndexPair _search(pNode searchNode, Key key);
+	void _erase(pNode node, Key key);
+	void insertNonfull(pNode node, Key key);
+	void splitChild(pNode node, int i);
+	pNode allocateNode();
+	int normalizeNodeForErasing(pNode parentNode, int i);
+	pNode unionNodesAroundKey(pNode left, Key key, pNode right);
+	static size_t subtreeKeys(pNode node) { return node ? node->subtreeKeys : 0; }
+	static void recountSubtreeKeys(pNode node);
+	size_t countLess(Key key, bool withEqual) const;
+	void collectKeys(pNode node, std::vector<Key>& keys) const;
+	template<typename Function> void forEachNode(pNode node, Function f) const;
+	int height() const;
+	bool isEmpty(const Subtree& subtree) const { return subtree.root->leaf && subtree.root->size() == 0; }
+	Subtree join3(Subtree left, Key key, Subtree right);
+	void splitSubtree(pNode node, int nodeHeight, Key key, Subtree& less, Subtree& notLess);
+	Subtree sliceNode(pNode node, int nodeHeight, int firstChild, int lastChild);
+	void rebalancePair(pNode parent, int i);
+	void splitOversizedChild(pNode parent, int i);
+	size_t maxSubtreeKeys(int height) const;
+	pNode buildSubtree(const Key* keys, size_t size, int height, bool isRoot, unsigned threads);
+	static void parallelSort(std::vector<Key>& keys, unsigned threads);
+	int diskRead(pNode node) const;
+	int diskReadAsync(pNode node) const;
+	int diskWrite(pNode node);
+	int minDegree;
+	std::pmr::memory_resource* resource;
+	pNode root;
+};
+
+template<typename Key>
+BTree<Key>::BTree(int _minDegree, std::pmr::memory_resource* _resource)
+	: minDegree{_minDegree}, resource{_resource}
+{
+	root = allocateNode();
+	root->leaf = true;
+	diskWrite(root);
+}
+
+/*
+	Builds tree from sorted keys without any splitting.
+	Shape depends only on number of keys n and t:
+		height is the smallest one which can keep n keys,
+		every node has the smallest possible number of children(but at least t, 2 for root),
+		and keys are distributed between children as evenly as possible.
+*/
+template<typename Key>
+template<typename InputIt>
+BTree<Key> BTree<Key>::fromSorted(int _minDegree, InputIt first, InputIt last, std::pmr::memory_resource* _resource)
+{
+	std::vector<Key> keys(first, last);
+	BTree<Key> tree(_minDegree, _resource);
+	int height = 0;
+	while (tree.maxSubtreeKeys(height) < keys.size())
+	{
+		++height;
+	}
+	tree.root = tree.buildSubtree(keys.data(), keys.size(), height, true, 1);
+	return tree;
+}
+
+/*
+	Parallel bulk building from unsorted keys:
+		1. keys are sorted in parts by threads, and parts are merged pairwise, also in threads;
+		2. subtrees of root(and deeper, while there are free threads) are built concurrently.
+	Resulting tree has exactly the same shape as fromSorted.
+*/
+template<typename Key>
+BTree<Key> BTree<Key>::fromUnsorted(int _minDegree, std::vector<Key> keys, unsigned threads, std::pmr::memory_resource* _resource)
+{
+	threads = std::max(threads, 1u);
+	parallelSort(keys, threads);
+	BTree<Key> tree(_minDegree, _resource);
+	int height = 0;
+	while (tree.maxSubtreeKeys(height) < keys.size())
+	{
+		++height;
+	}
+	tree.root = tree.buildSubtree(keys.data(), keys.size(), height, true, threads);
+	return tree;
+}
+
+/*
+	Wraps private search with root as first arg.
+*/
+template<typename Key>
+typename BTree<Key>::pNodeIndexPair BTree<Key>::search(Key key)
+{
+	return _search(root, key);
+}
+
+template<typename Key>
+void BTree<Key>::insert(Key key)
+{
+	pNode curNode = root;
+	// no space in root - need to do splitting and to make new root
+	if (curNode->size() == (2 * minDegree - 1))
+	{
+		pNode newParent = allocateNode();
+		root = newParent;
+		newParent->leaf = false;
+		newParent->subtreeKeys = curNode->subtreeKeys;
+		newParent->appendChild(curNode);
+		splitChild(newParent, 0);
+		insertNonfull(newParent, key);
+	}
+	// enough space
+	else
+	{
+		insertNonfull(curNode, key);
+	}
+}
+
+template<typename Key>
+void BTree<Key>::erase(Key key)
+{
+	// empty tree or no such key - nothing to erase(and subtree sizes must stay the same)
+	if (root->size() == 0 || !_search(root, key))
+	{
+		return;
+	}
+	_erase(root, key);
+	// root has lost its last key after joining of its children - tree becomes lower
+	if (root->size() == 0 && !root->leaf)
+	{
+		root = root->getChild(0);
+	}
+}
+
+
+/*
+	predecessor - rightmost ancestor of left sibling of 'node''s key with keyIndex
+*/
+template<typename Key>
+typename BTree<Key>::pNode BTree<Key>::predecessor(pNode node, int keyIndex)
+{
+	pNode curNode = node->getChild(keyIndex);
+	while (!curNode->leaf)
+	{
+		curNode = curNode->getChild(curNode->size());
+		diskRead(curNode);
+	}
+	return curNode;
+}
+
+/*
+	successor - leftmost ancestor of right sibling of 'node''s key with keyIndex
+*/
+template<typename Key>
+typename BTree<Key>::pNode BTree<Key>::successor(pNode node, int keyIndex)
+{
+	pNode curNode = node->getChild(keyIndex + 1);
+	while (!curNode->leaf)
+	{
+		curNode = curNode->getChild(0);
+		diskRead(curNode);
+	}
+	return curNode;
+}
+
+/*
+	Private version of search in B-Tree.
+	For searching in full tree, call with root as first arg.
+*/
+template<typename Key>
+typename BTree<Key>::pNodeIndexPair BTree<Key>::_search(pNode searchNode, Key key)
+{
+	int i = 0;
+	// checking this node keys
+	while (i < searchNode->size() && key > (*searchNode)[i])
+	{
+		++i;
+	}
+	// found one
+	if (i < searchNode->size() && key == (*searchNode)[i])
+	{
+		NodeIndexPair nodeIndexPair = std::make_pair(searchNode, i);
+		return std::make_shared<NodeIndexPair>(nodeIndexPair);
+	}
+	// not found and leaf
+	else if (searchNode->leaf)
+	{
+		return nullptr;
+	}
+	// continue searching
+	else
+	{
+		return _search(searchNode->getChild(i), key);
+	}
+}
+
+/*
+	Searches keys with up to inFlight descents at once.
+	Descents go down in turn: every one reads its node, chooses child and only starts
+		reading it(diskReadAsync), then next descent does the same, so reads of
+		different descents overlap and each of them is waited for only one time,
+		when its descent comes back to it.
+	Slot of finished descent takes next key at once, so inFlight descents go until
+		keys are over(not only in the beginning of every group of inFlight keys).
+	Result i is the same as search(keys[i]).
+*/
+template<typename Key>
+std::vector<typename BTree<Key>::pNodeIndexPair> BTree<Key>::searchBatch(const std::vector<Key>& keys, int inFlight)
+{
+	std::vector<pNodeIndexPair> results(keys.size());
+	size_t slots = std::min(keys.size(), size_t(std::max(inFlight, 1)));
+	// current node and key of every descent, nullptr node for finished slot
+	std::vector<pNode> nodes(slots, root);
+	std::vector<size_t> slotKeys(slots);
+	for (size_t j = 0; j < slots; ++j)
+	{
+		slotKeys[j] = j;
+	}
+	size_t nextKey = slots;
+	size_t active = slots;
+	if (active > 0)
+	{
+		diskReadAsync(root);
+	}
+	while (active > 0)
+	{
+		for (size_t j = 0; j < slots; ++j)
+		{
+			// reference: node is kept by tree, so no counter of shared_ptr is touched
+			const pNode& curNode = nodes[j];
+			if (!curNode)
+			{
+				continue;
+			}
+			diskRead(curNode);
+			size_t k = slotKeys[j];
+			const Key& key = keys[k];
+			int i = 0;
+			while (i < curNode->size() && (*curNode)[i] < key)
+			{
+				++i;
+			}
+			if (i < curNode->size() && key == (*curNode)[i])
+			{
+				results[k] = std::make_shared<NodeIndexPair>(curNode, i);
+			}
+			else if (!curNode->leaf)
+			{
+				nodes[j] = curNode->getChild(i);
+				diskReadAsync(nodes[j]);
+				continue;
+			}
+			// descent is finished - next key starts from root in this slot
+			if (nextKey < keys.size())
+			{
+				slotKeys[j] = nextKey++;
+				nodes[j] = root;
+			}
+			else
+			{
+				nodes[j] = nullptr;
+				--active;
+			}
+		}
+	}
+	return results;
+}
+
+/*
+	Splits keys into parts(at most threads of them) and runs searchBatch of every part
+		on persistent BTreeWorkers, so no thread is started per call.
+	Parts begin at once, future joins their results in order of keys when get() is called.
+	Tree must not be changed or destroyed until get() returns.
+*/
+template<typename Key>
+std::future<std::vector<typename BTree<Key>::pNodeIndexPair>> BTree<Key>::searchAsync(std::vector<Key> keys, unsigned threads)
+{
+	size_t parts = std::max<size_t>(1, std::min<size_t>(threads, keys.size()));
+	std::vector<std::future<std::vector<pNodeIndexPair>>> partResults;
+	for (size_t part = 0; part < parts; ++part)
+	{
+		// shared_ptr because std::function needs copyable task
+		auto task = std::make_shared<std::packaged_task<std::vector<pNodeIndexPair>()>>(
+			[this, partKeys = std::vector<Key>(keys.begin() + keys.size() * part / parts, keys.begin() + keys.size() * (part + 1) / parts)]()
+		{
+			return searchBatch(partKeys);
+		});
+		partResults.push_back(task->get_future());
+		BTreeWorkers::instance().submit([task]() { (*task)(); });
+	}
+	return std::async(std::launch::deferred, [](std::vector<std::future<std::vector<pNodeIndexPair>>> partResults)
+	{
+		std::vector<pNodeIndexPair> results;
+		for (auto& partResult : partResults)
+		{
+			std::vector<pNodeIndexPair> part = partResult.get();
+			results.insert(results.end(), part.begin(), part.end());
+		}
+		return results;
+	}, std::move(partResults));
+}
+
+/*
+	Main function of erasing(as in Cormen's book).
+	Every node we are going down to has at least t keys(see normalizeNodeForErasing),
+		so key can be taken from it without breaking invariants.
+	Key must be in subtree of node, every node on the way loses one key of its subtree.
+*/
+template<typename Key>
+void BTree<Key>::_erase(pNode node, Key key)
+{
+	diskRead(node);
+	--node->subtreeKeys;
+	int keyIndex = 0;
+	while (keyIndex < node->size() && (*node)[keyIndex] < key)
+	{
+		++keyIndex;
+	}
+	bool found = keyIndex < node->size() && (*node)[keyIndex] == key;
+	// case 1: node is leaf - simply erasing key(if it is here)
+	if (node->leaf)
+	{
+		if (found)
+		{
+			node->eraseKey(keyIndex);
+			node->resizeKeysAndChildren(node->size());
+			diskWrite(node);
+		}
+		return;
+	}
+	// case 3: key is not in this node - going to child which can contain it
+	if (!found)
+	{
+		int childIndex = normalizeNodeForErasing(node, keyIndex);
+		_erase(node->getChild(childIndex), key);
+		return;
+	}
+	// case 2: key is in internal node
+	pNode leftNode = node->getChild(keyIndex);
+	pNode rightNode = node->getChild(keyIndex + 1);
+	diskRead(leftNode);
+	diskRead(rightNode);
+	// 2.a - prior child has t or more keys - replacing key with its predecessor
+	//		and erasing predecessor from prior child
+	if (leftNode->size() >= minDegree)
+	{
+		pNode predecessorNode = predecessor(node, keyIndex);
+		// size - 1 because predecessor is always rightmost key
+		Key swapKey = (*predecessorNode)[predecessorNode->size() - 1];
+		(*node)[keyIndex] = swapKey;
+		diskWrite(node);
+		_erase(leftNode, swapKey);
+	}
+	// 2.b - next child has t or more keys - the same with successor
+	else if (rightNode->size() >= minDegree)
+	{
+		pNode successorNode = successor(node, keyIndex);
+		// 0 because successor is always leftmost key
+		Key swapKey = (*successorNode)[0];
+		(*node)[keyIndex] = swapKey;
+		diskWrite(node);
+		_erase(rightNode, swapKey);
+	}
+	// 2.c - both prior and next children have t - 1 keys:
+	//		joining them around key(2t - 1 keys) and erasing key from joined node
+	else
+	{
+		pNode unionNode = unionNodesAroundKey(leftNode, key, rightNode);
+		node->eraseKey(keyIndex);
+		node->eraseChild(keyIndex + 1);
+		node->setChild(keyIndex, unionNode);
+		diskWrite(unionNode);
+		diskWrite(node);
+		_erase(unionNode, key);
+	}
+}
+
+/*
+	Inserting if root is not full - main inserting function.
+*/
+template<typename Key>
+void BTree<Key>::insertNonfull(pNode node, Key key)
+{
+	int i = node->size() - 1;
+	// key goes to subtree of every node on the way
+	++node->subtreeKeys;
+	// if leaf - simply searching for place to insert and inserting
+	if (node->leaf)
+	{
+		node->resizeKeysAndChildren(node->size() + 1);
+		// moving elements to right
+		while (i >= 0 && key < (*node)[i])
+		{
+			(*node)[i + 1] = (*node)[i];
+			--i;
+		}
+		(*node)[i + 1] = key;
+		diskWrite(node);
+	}
+	// else - recursively going by tree, and sometimes, if needed,
+	//		splitting it
+	else
+	{
+		while (i >= 0 && key < (*node)[i]) { --i; }
+		++i;
+		// filling contents of i'th child of node
+		diskRead(node->getChild(i));
+		if (node->getChild(i)->size() == (2 * minDegree - 1))
+		{
+			splitChild(node, i);
+			if (key > (*node)[i]) { ++i; }
+		}
+		insertNonfull(node->getChild(i), key);
+	}
+}
+
+/*===================================================================
+	   ------------					 -------------
+	   |....N,W...|					 |... N S W..|
+	   ------------					 -------------
+			|			------>			  /  \
+			|							 /    \
+	------------------				--------- ---------
+	|P Q R S T U V   |				| P Q R | | T U V |
+	-----------------				--------- ---------
+	
+	splits full node as on illustration
+	median goes to parent
+	two children are splitted and now have t-1 elements each(before splitting
+		node had 2t-1)
+	if parent is also full, doing recursively
+
+	Node x is splitted to two nodes - y and z
+======================================================================
+*/
+template<typename Key>
+void BTree<Key>::splitChild(pNode x, int i)
+{
+	int t = minDegree;
+	pNode z = allocateNode();
+	pNode y = x->getChild(i);
+	z->leaf = y->leaf;
+	z->resizeKeysAndChildren(t - 1);
+	// moving first (t - 1) nodes of y to z
+	for (int j = 0; j < (t - 1); ++j)
+	{
+		(*z)[j] = (*y)[j + t];
+	}
+	// setting z child
+	if (!(y->leaf))
+	{
+		for (int j = 0; j < t; ++j)
+		{
+			z->setChild(j, y->getChild(j + t));
+		}
+	}
+	Key keyGoingUp = (*y)[t - 1];
+	y->resizeKeysAndChildren(t - 1);
+	x->resizeKeysAndChildren(x->size() + 1);
+	// moving x children after i + 1 to right
+	for (int j = x->size() - 1; j >= i + 1; --j)
+	{
+		x->setChild(j + 1, x->getChild(j));
+	}
+	// inserting z - new child of x
+	x->setChild(i + 1, z);
+	recountSubtreeKeys(y);
+	recountSubtreeKeys(z);
+	for (int j = x->size() - 2; j >= i; --j)
+	{
+		(*x)[j + 1] = (*x)[j];
+	}
+	// inserting new key
+	(*x)[i] = keyGoingUp;
+	diskWrite(y);
+	diskWrite(z);
+	diskWrite(x);
+}
+
+/*
+	Allocates node and page on disk for this node.
+	NOW allocates only in memory.
+*/
+template<typename Key>
+typename BTree<Key>::pNode BTree<Key>::allocateNode()
+{
+	pNode newNode = std::allocate_shared<BTreeNode<Key>>(std::pmr::polymorphic_allocator<BTreeNode<Key>>(resource), resource);
+	return newNode;
+}
+
+/*
+	When erasing from B-Tree and traversing to next node,
+	we should be sure that it has at least t(minDegree) keys.
+	We can have 3 cases.
+	Returns index of child to go to(it is childIndex - 1 if child was joined with left sibling,
+		else it is childIndex).
+*/
+template<typename Key>
+int BTree<Key>::normalizeNodeForErasing(pNode parentNode, int childIndex)
+{
+	pNode normalizingNode = parentNode->getChild(childIndex);
+	diskRead(normalizingNode);
+	// case 1: all right - node has t or more keys
+	if (normalizingNode->size() >= minDegree)
+	{
+		return childIndex;
+	}
+	// the first child has no left sibling and the last one has no right sibling
+	pNode leftNode = (childIndex > 0) ? parentNode->getChild(childIndex - 1) : nullptr;
+	pNode rightNode = (childIndex < parentNode->size()) ? parentNode->getChild(childIndex + 1) : nullptr;
+	if (leftNode) diskRead(leftNode);
+	if (rightNode) diskRead(rightNode);
+	/*
+	case 2: left or right sibling has t or more keys:
+		in this case we are moving parent-key for normalizing node and sibling to norm node,
+		then taking one(closest) key from this sibling and placing it as this parent's key,
+		and moving closest child of sibling to norm node.
+	*/
+	// 2.1. left sibling(separator is key childIndex - 1)
+	if (leftNode && leftNode->size() >= minDegree)
+	{
+		int keyIndex = childIndex - 1;
+		normalizingNode->prependKey((*parentNode)[keyIndex]);
+		(*parentNode)[keyIndex] = (*leftNode)[leftNode->size() - 1];
+		pNode movingChild = leftNode->getChild(leftNode->size());
+		normalizingNode->prependChild(movingChild);
+		leftNode->eraseChild(leftNode->size());
+		leftNode->eraseKey(leftNode->size() - 1);
+		normalizingNode->subtreeKeys += 1 + subtreeKeys(movingChild);
+		leftNode->subtreeKeys -= 1 + subtreeKeys(movingChild);
+		diskWrite(leftNode);
+	}
+	// 2.2 right sibling(separator is key childIndex)
+	else if (rightNode && rightNode->size() >= minDegree)
+	{
+		int keyIndex = childIndex;
+		normalizingNode->appendKey((*parentNode)[keyIndex]);
+		(*parentNode)[keyIndex] = (*rightNode)[0];
+		pNode movingChild = rightNode->getChild(0);
+		normalizingNode->appendChild(movingChild);
+		rightNode->eraseChild(0);
+		rightNode->eraseKey(0);
+		normalizingNode->subtreeKeys += 1 + subtreeKeys(movingChild);
+		rightNode->subtreeKeys -= 1 + subtreeKeys(movingChild);
+		diskWrite(rightNode);
+	}
+	/*
+	case 3: left AND right siblings have t - 1 keys.
+		In this case we are joining normalizing node with its sibling(left or right),
+			(left here if presented, else right),
+		and making their key-separator from parentNode this joined node's new median.
+	*/
+	else if (leftNode)
+	{
+		pNode unionNode = unionNodesAroundKey(leftNode, (*parentNode)[childIndex - 1], normalizingNode);
+		parentNode->eraseKey(childIndex - 1);
+		parentNode->eraseChild(childIndex);
+		// replacing instead of erasing
+		parentNode->setChild(childIndex - 1, unionNode);
+		diskWrite(unionNode);
+		diskWrite(parentNode);
+		// because we have moved key to left
+		return childIndex - 1;
+	}
+	else
+	{
+		pNode unionNode = unionNodesAroundKey(normalizingNode, (*parentNode)[childIndex], rightNode);
+		parentNode->eraseKey(childIndex);
+		parentNode->eraseChild(childIndex + 1);
+		parentNode->setChild(childIndex, unionNode);
+		diskWrite(unionNode);
+		diskWrite(parentNode);
+		return childIndex;
+	}
+	diskWrite(normalizingNode);
+	diskWrite(parentNode);
+	return childIndex;
+}
+
+/*
+	makes node left + right
+	keys become: left.keys + key + right.keys
+	children become: left.children + right.children
+*/
+template<typename Key>
+typename BTree<Key>::pNode BTree<Key>::unionNodesAroundKey(pNode left, Key key, pNode right)
+{
+	pNode unionNode = allocateNode();
+	unionNode->leaf = left->leaf && right->leaf;
+	for (int j = 0; j < left->size(); ++j)
+	{
+		unionNode->appendKey((*left)[j]);
+		unionNode->appendChild(left->getChild(j));
+	}
+	unionNode->appendChild(left->getChild(left->size()));
+	unionNode->appendKey(key);
+	for (int j = 0; j < right->size(); ++j)
+	{
+		unionNode->appendKey((*right)[j]);
+		unionNode->appendChild(right->getChild(j));
+	}
+	unionNode->appendChild(right->getChild(right->size()));
+	unionNode->subtreeKeys = left->subtreeKeys + 1 + right->subtreeKeys;
+	return unionNode;
+}
+
+/*
+	Number of keys which are smaller than key.
+*/
+template<typename Key>
+size_t BTree<Key>::rank(Key key) const
+{
+	return countLess(key, false);
+}
+
+/*
+	k-th smallest key(from 0), k must be less than size().
+*/
+template<typename Key>
+Key BTree<Key>::select(size_t k) const
+{
+	if (k >= size())
+	{
+		throw std::out_of_range("BTree::select(): k is out of range");
+	}
+	pNode curNode = root;
+	for (;;)
+	{
+		diskRead(curNode);
+		if (curNode->leaf)
+		{
+			return (*curNode)[(int)k];
+		}
+		// skipping whole subtrees and keys before k-th key
+		int i = 0;
+		for (; i < curNode->size(); ++i)
+		{
+			size_t childKeys = curNode->getChild(i)->subtreeKeys;
+			if (k < childKeys)
+			{
+				break;
+			}
+			k -= childKeys;
+			if (k == 0)
+			{
+				return (*curNode)[i];
+			}
+			--k;
+		}
+		curNode = curNode->getChild(i);
+	}
+}
+
+/*
+	Number of keys in [lo, hi].
+*/
+template<typename Key>
+size_t BTree<Key>::countRange(Key lo, Key hi) const
+{
+	if (hi < lo)
+	{
+		return 0;
+	}
+	return countLess(hi, true) - countLess(lo, false);
+}
+
+/*
+	Number of keys smaller than key(or not bigger, if withEqual) with one descent:
+		all children before the one we go to are counted with their subtree sizes.
+*/
+template<typename Key>
+size_t BTree<Key>::countLess(Key key, bool withEqual) const
+{
+	size_t count = 0;
+	pNode curNode = root;
+	for (;;)
+	{
+		diskRead(curNode);
+		int i = 0;
+		while (i < curNode->size() && ((*curNode)[i] < key || (withEqual && !(key < (*curNode)[i]))))
+		{
+			if (!curNode->leaf)
+			{
+				count += curNode->getChild(i)->subtreeKeys;
+			}
+			++count;
+			++i;
+		}
+		if (curNode->leaf)
+		{
+			return count;
+		}
+		curNode = curNode->getChild(i);
+	}
+}
+
+template<typename Key>
+FrozenBTree<Key> BTree<Key>::freeze() const
+{
+	std::vector<Key> keys;
+	keys.reserve(size());
+	collectKeys(root, keys);
+	return FrozenBTree<Key>(keys.begin(), keys.end(), FrozenBTree<Key>::defaultLayout(keys.size()), resource);
+}
+
+/*
+	Keys >= key are moved to returned tree, keys < key stay here.
+	Path of key is cut: at every node of it, children to the left of the path(with keys
+		between them) become one piece of the left tree, children to the right - piece
+		of the right tree, and pieces are joined back bottom-up with separator keys(join3).
+		Heights of joined pieces grow along the path, so all joins cost O(height) in total.
+*/
+template<typename Key>
+BTree<Key> BTree<Key>::split(Key key)
+{
+	BTree<Key> right(minDegree, resource);
+	Subtree less;
+	Subtree notLess;
+	splitSubtree(root, height(), key, less, notLess);
+	root = less.root;
+	right.root = notLess.root;
+	return right;
+}
+
+/*
+	Concatenates two trees, all keys of left must be not bigger than keys of right.
+	Keys are moved: left and right become empty(each keeps its own memory resource).
+	Maximum of left is taken out and used as separator of join3.
+	Joined tree lives in memory resource of left: if right is in another one,
+		it is copied there first(clone, O(size of right)), so nodes of one tree
+		never come from two resources.
+*/
+template<typename Key>
+BTree<Key> BTree<Key>::join(BTree& left, BTree& right)
+{
+	if (left.minDegree != right.minDegree)
+	{
+		throw std::invalid_argument("BTree::join(): trees have different minimal degrees");
+	}
+	if (left.size() != 0 && right.size() != 0 && right.select(0) < left.select(left.size() - 1))
+	{
+		throw std::invalid_argument("BTree::join(): key ranges of trees overlap");
+	}
+	std::pmr::memory_resource* rightResource = right.resource;
+	if (rightResource != left.resource)
+	{
+		right = right.clone(left.resource);
+	}
+	BTree<Key> joined(left.minDegree, left.resource);
+	if (left.size() == 0 || right.size() == 0)
+	{
+		joined.root = (left.size() == 0) ? right.root : left.root;
+	}
+	else
+	{
+		Key separator = left.select(left.size() - 1);
+		left.erase(separator);
+		Subtree joinedTree = joined.join3(Subtree{ left.root, left.height() }, separator, Subtree{ right.root, right.height() });
+		joined.root = joinedTree.root;
+	}
+	left = BTree<Key>(left.minDegree, left.resource);
+	right = BTree<Key>(right.minDegree, rightResource);
+	return joined;
+}
+
+template<typename Key>
+int BTree<Key>::height() const
+{
+	int treeHeight = 0;
+	for (pNode curNode = root; !curNode->leaf; curNode = curNode->getChild(0))
+	{
+		++treeHeight;
+	}
+	return treeHeight;
+}
+
+/*
+	Joins left tree, key and right tree(left < key <= right).
+	Lower tree is grafted as the last(first) child of node of the next height on the
+		right(left) spine of higher one. Full nodes on the spine are split in advance,
+		as in insert, and grafted root, which can have less than t - 1 keys, is rebalanced
+		with its sibling. Subtree sizes are recounted on the spine.
+*/
+template<typename Key>
+typename BTree<Key>::Subtree BTree<Key>::join3(Subtree left, Key key, Subtree right)
+{
+	int t = minDegree;
+	// one tree is empty - simply inserting key to another
+	if (isEmpty(left) || isEmpty(right))
+	{
+		BTree<Key> tree(minDegree, resource);
+		tree.root = isEmpty(left) ? right.root : left.root;
+		tree.insert(key);
+		return Subtree{ tree.root, tree.height() };
+	}
+	if (left.height == right.height)
+	{
+		if (left.root->size() + 1 + right.root->size() <= 2 * t - 1)
+		{
+			return Subtree{ unionNodesAroundKey(left.root, key, right.root), left.height };
+		}
+		pNode parent = allocateNode();
+		parent->appendKey(key);
+		parent->appendChild(left.root);
+		parent->appendChild(right.root);
+		if (left.root->size() < t - 1 || right.root->size() < t - 1)
+		{
+			rebalancePair(parent, 0);
+		}
+		recountSubtreeKeys(parent);
+		diskWrite(parent);
+		return Subtree{ parent, left.height + 1 };
+	}
+	bool graftRight = left.height > right.height;
+	Subtree high = graftRight ? left : right;
+	Subtree low = graftRight ? right : left;
+	// full root - splitting it in advance
+	if (high.root->size() == 2 * t - 1)
+	{
+		pNode newRoot = allocateNode();
+		newRoot->appendChild(high.root);
+		splitChild(newRoot, 0);
+		high.root = newRoot;
+		++high.height;
+	}
+	std::vector<pNode> path{ high.root };
+	pNode curNode = high.root;
+	for (int h = high.height; h > low.height + 1; --h)
+	{
+		int i = graftRight ? curNode->size() : 0;
+		diskRead(curNode->getChild(i));
+		if (curNode->getChild(i)->size() == 2 * t - 1)
+		{
+			splitChild(curNode, i);
+			i = graftRight ? curNode->size() : 0;
+		}
+		curNode = curNode->getChild(i);
+		path.push_back(curNode);
+	}
+	if (graftRight)
+	{
+		curNode->appendKey(key);
+		curNode->appendChild(low.root);
+		if (low.root->size() < t - 1)
+		{
+			rebalancePair(curNode, curNode->size() - 1);
+		}
+	}
+	else
+	{
+		curNode->prependKey(key);
+		curNode->prependChild(low.root);
+		if (low.root->size() < t - 1)
+		{
+			rebalancePair(curNode, 0);
+		}
+	}
+	for (auto node = path.rbegin(); node != path.rend(); ++node)
+	{
+		recountSubtreeKeys(*node);
+		diskWrite(*node);
+	}
+	return high;
+}
+
+template<typename Key>
+void BTree<Key>::splitSubtree(pNode node, int nodeHeight, Key key, Subtree& less, Subtree& notLess)
+{
+	diskRead(node);
+	if (node->leaf)
+	{
+		pNode lessLeaf = allocateNode();
+		pNode notLessLeaf = allocateNode();
+		lessLeaf->leaf = notLessLeaf->leaf = true;
+		for (int i = 0; i < node->size(); ++i)
+		{
+			((*node)[i] < key ? lessLeaf : notLessLeaf)->appendKey((*node)[i]);
+		}
+		for (pNode leaf : { lessLeaf, notLessLeaf })
+		{
+			leaf->resizeKeysAndChildren(leaf->size());
+			leaf->subtreeKeys = leaf->size();
+			diskWrite(leaf);
+		}
+		less = Subtree{ lessLeaf, 0 };
+		notLess = Subtree{ notLessLeaf, 0 };
+		return;
+	}
+	int i = 0;
+	while (i < node->size() && (*node)[i] < key)
+	{
+		++i;
+	}
+	Subtree childLess;
+	Subtree childNotLess;
+	splitSubtree(node->getChild(i), nodeHeight - 1, key, childLess, childNotLess);
+	less = (i == 0) ? childLess : join3(sliceNode(node, nodeHeight, 0, i - 1), (*node)[i - 1], childLess);
+	notLess = (i == node->size()) ? childNotLess : join3(childNotLess, (*node)[i], sliceNode(node, nodeHeight, i + 1, node->size()));
+}
+
+/*
+	Piece of node with children firstChild...lastChild and keys between them.
+	Piece with one child is this child itself.
+*/
+template<typename Key>
+typename BTree<Key>::Subtree BTree<Key>::sliceNode(pNode node, int nodeHeight, int firstChild, int lastChild)
+{
+	if (firstChild == lastChild)
+	{
+		return Subtree{ node->getChild(firstChild), nodeHeight - 1 };
+	}
+	pNode piece = allocateNode();
+	for (int i = firstChild; i < lastChild; ++i)
+	{
+		piece->appendChild(node->getChild(i));
+		piece->appendKey((*node)[i]);
+	}
+	piece->appendChild(node->getChild(lastChild));
+	recountSubtreeKeys(piece);
+	diskWrite(piece);
+	return Subtree{ piece, nodeHeight };
+}
+
+/*
+	Joins children i and i + 1 around key i,
+		if result is too big for one node, it is split in the middle,
+		so both children get at least t - 1 keys.
+*/
+template<typename Key>
+void BTree<Key>::rebalancePair(pNode parent, int i)
+{
+	pNode unionNode = unionNodesAroundKey(parent->getChild(i), (*parent)[i], parent->getChild(i + 1));
+	parent->eraseKey(i);
+	parent->eraseChild(i + 1);
+	parent->setChild(i, unionNode);
+	if (unionNode->size() > 2 * minDegree - 1)
+	{
+		splitOversizedChild(parent, i);
+	}
+	diskWrite(unionNode);
+	diskWrite(parent);
+}
+
+/*
+	Same as splitChild, but for node with 2t...4t - 1 keys: median goes to parent.
+*/
+template<typename Key>
+void BTree<Key>::splitOversizedChild(pNode parent, int i)
+{
+	pNode y = parent->getChild(i);
+	pNode z = allocateNode();
+	z->leaf = y->leaf;
+	int median = y->size() / 2;
+	for (int j = median + 1; j < y->size(); ++j)
+	{
+		z->appendKey((*y)[j]);
+		z->appendChild(y->getChild(j));
+	}
+	z->appendChild(y->getChild(y->size()));
+	Key keyGoingUp = (*y)[median];
+	y->resizeKeysAndChildren(median);
+	parent->insertKey(i, keyGoingUp);
+	parent->insertChild(i + 1, z);
+	recountSubtreeKeys(y);
+	recountSubtreeKeys(z);
+	diskWrite(y);
+	diskWrite(z);
+}
+
+/*
+	In-order walk: keys of node go between its children.
+*/
+template<typename Key>
+void BTree<Key>::collectKeys(pNode node, std::vector<Key>& keys) const
+{
+	diskRead(node);
+	for (int i = 0; i < node->size(); ++i)
+	{
+		if (!node->leaf)
+		{
+			// next sibling is read while this child is walked
+			diskReadAsync(node->getChild(i + 1));
+			collectKeys(node->getChild(i), keys);
+		}
+		keys.push_back((*node)[i]);
+	}
+	if (!node->leaf)
+	{
+		collectKeys(node->getChild(node->size()), keys);
+	}
+}
+
+/*
+	Sums sizes of all nodes, O(n).
+*/
+template<typename Key>
+BTreeMemoryUsage BTree<Key>::memoryUsage() const
+{
+	BTreeMemoryUsage usage{ 0, 0, 0, 0, 0 };
+	forEachNode(root, [&usage](const pNode& node)
+	{
+		node->addMemoryUsage(usage);
+	});
+	return usage;
+}
+
+template<typename Key>
+void BTree<Key>::shrinkToFit()
+{
+	forEachNode(root, [this](const pNode& node)
+	{
+		node->shrinkToFit();
+		diskWrite(node);
+	});
+}
+
+/*
+	Built with fromSorted, so copy has no slack(and can be moved to memory of another NUMA node).
+*/
+template<typename Key>
+BTree<Key> BTree<Key>::clone(std::pmr::memory_resource* _resource) const
+{
+	std::vector<Key> keys;
+	keys.reserve(size());
+	collectKeys(root, keys);
+	return fromSorted(minDegree, keys.begin(), keys.end(), _resource);
+}
+
+template<typename Key>
+template<typename Function>
+void BTree<Key>::forEachNode(pNode node, Function f) const
+{
+	diskRead(node);
+	f(node);
+	if (!node->leaf)
+	{
+		for (int i = 0; i <= node->size(); ++i)
+		{
+			forEachNode(node->getChild(i), f);
+		}
+	}
+}
+
+/*
+	Subtree size from own keys and children's subtree sizes.
+*/
+template<typename Key>
+void BTree<Key>::recountSubtreeKeys(pNode node)
+{
+	node->subtreeKeys = node->size();
+	if (!node->leaf)
+	{
+		for (int i = 0; i <= node->size(); ++i)
+		{
+			node->subtreeKeys += node->getChild(i)->subtreeKeys;
+		}
+	}
+}
+
+/*
+	Maximal number of keys in subtree of height(leaf has height 0): (2t)^(height + 1) - 1.
+*/
+template<typename Key>
+size_t BTree<Key>::maxSubtreeKeys(int height) const
+{
+	size_t keys = 1;
+	for (int h = 0; h <= height; ++h)
+	{
+		// saturating - such subtree can keep any number of keys anyway
+		if (keys > std::numeric_limits<size_t>::max() / (2 * minDegree))
+		{
+			return std::numeric_limits<size_t>::max();
+		}
+		keys *= 2 * minDegree;
+	}
+	return keys - 1;
+}
+
+/*
+	Builds subtree of given height from size sorted keys.
+	Number of children is the smallest one which can keep all keys, so every child
+		gets at least t^height - 1 keys and invariants hold without any checks.
+	With threads > 1 children are built in separate threads, result does not depend on threads.
+*/
+template<typename Key>
+typename BTree<Key>::pNode BTree<Key>::buildSubtree(const Key* keys, size_t size, int height, bool isRoot, unsigned threads)
+{
+	pNode node = allocateNode();
+	if (height == 0)
+	{
+		node->leaf = true;
+		node->subtreeKeys = size;
+		node->resizeKeysAndChildren((int)size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			(*node)[(int)i] = keys[i];
+		}
+		diskWrite(node);
+		return node;
+	}
+	size_t childCapacity = maxSubtreeKeys(height - 1) + 1;
+	size_t childrenCount = std::max<size_t>(isRoot ? 2 : minDegree, (size + 1 + childCapacity - 1) / childCapacity);
+	// keys without separators are split evenly, first (childKeys % childrenCount) children get one more
+	size_t childKeys = size - (childrenCount - 1);
+	std::vector<size_t> starts(childrenCount);
+	std::vector<size_t> sizes(childrenCount);
+	size_t pos = 0;
+	node->subtreeKeys = size;
+	node->resizeKeysAndChildren((int)childrenCount - 1);
+	for (size_t i = 0; i < childrenCount; ++i)
+	{
+		starts[i] = pos;
+		sizes[i] = childKeys / childrenCount + (i < childKeys % childrenCount);
+		pos += sizes[i];
+		if (i + 1 < childrenCount)
+		{
+			(*node)[(int)i] = keys[pos++];
+		}
+	}
+	// small subtrees are not worth a thread
+	if (threads <= 1 || size < 4096)
+	{
+		for (size_t i = 0; i < childrenCount; ++i)
+		{
+			node->setChild((int)i, buildSubtree(keys + starts[i], sizes[i], height - 1, false, 1));
+		}
+	}
+	else
+	{
+		size_t groups = std::min<size_t>(threads, childrenCount);
+		unsigned childThreads = std::max<unsigned>(1, threads / (unsigned)childrenCount);
+		std::vector<std::thread> workers;
+		for (size_t g = 0; g < groups; ++g)
+		{
+			workers.emplace_back([&, g]()
+			{
+				for (size_t i = g * childrenCount / groups; i < (g + 1) * childrenCount / groups; ++i)
+				{
+					// every thread writes only its own children slots
+					node->setChild((int)i, buildSubtree(keys + starts[i], sizes[i], height - 1, false, childThreads));
+				}
+			});
+		}
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+	diskWrite(node);
+	return node;
+}
+
+/*
+	Sorts parts of keys in threads, then merges neighbour parts pairwise(also in threads)
+		until one sorted part is left.
+*/
+template<typename Key>
+void BTree<Key>::parallelSort(std::vector<Key>& keys, unsigned threads)
+{
+	size_t parts = std::min<size_t>(threads, keys.size() / 4096 + 1);
+	if (parts <= 1)
+	{
+		std::sort(keys.begin(), keys.end());
+		return;
+	}
+	std::vector<size_t> bounds;
+	for (size_t p = 0; p <= parts; ++p)
+	{
+		bounds.push_back(keys.size() * p / parts);
+	}
+	std::vector<std::thread> workers;
+	for (size_t p = 0; p < parts; ++p)
+	{
+		workers.emplace_back([&keys, &bounds, p]() { std::sort(keys.begin() + bounds[p], keys.begin() + bounds[p + 1]); });
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	while (bounds.size() > 2)
+	{
+		std::vector<size_t> merged;
+		workers.clear();
+		for (size_t p = 0; p + 1 < bounds.size(); p += 2)
+		{
+			merged.push_back(bounds[p]);
+			if (p + 2 < bounds.size())
+			{
+				workers.emplace_back([&keys, &bounds, p]()
+				{
+					std::inplace_merge(keys.begin() + bounds[p], keys.begin() + bounds[p + 1], keys.begin() + bounds[p + 2]);
+				});
+			}
+		}
+		merged.push_back(bounds.back());
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		bounds = std::move(merged);
+	}
+}
+
+/*
+	Reading contents of next child node from disk.
+	NOW it makes nothing.
+	Returns error code, or 0 on success.
+*/
+template<typename Key>
+int BTree<Key>::diskRead(pNode node) const
+{
+	return 0;
+}
+
+/*
+	Starting to read node from disk without waiting for it,
+		diskRead of this node waits for the end of reading.
+	NOW it only prefetches keys of node to cache.
+	Returns error code, or 0 on success.
+*/
+template<typename Key>
+int BTree<Key>::diskReadAsync(pNode node) const
+{
+	BTREE_PREFETCH(node.get());
+	BTREE_PREFETCH(node->keysData());
+	return 0;
+}
+
+template<typename Key>
+int BTree<Key>::diskWrite(pNode node)
+{
+	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,250 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <memory_resource>
+#include "Prefetch.hpp"
+
+/*
+	Immutable search tree over sorted keys, stored as one array without any pointers
+		(see BTree::freeze).
+	Keys are nodes of implicit complete binary search tree, which are placed in one of two layouts:
+		Eytzinger - breadth-first order(children of i are 2i and 2i + 1), exactly n keys;
+			search prefetches node 4 levels below(16 keys ahead), which is enough while tree
+			is small enough for these prefetches to hit memory in time;
+		VanEmdeBoas - tree of height h is split to top tree of height h/2 and bottom trees,
+			every one of them is stored contiguously and recursively in the same way,
+			so search touches O(log_B n) blocks for every block size B(cache lines, pages)
+			without knowing it. Tree is complete, so the last key is repeated as padding
+			(less than 2n keys in all). Positions of children are computed with
+			three small per-depth tables.
+	Search is branch-free: every level is one comparison, which chooses child and candidate
+		with conditional moves.
+	Eytzinger is default for all sizes: with prefetching it is faster than VanEmdeBoas
+		even for trees much bigger than cache(1.7s against 2.3s for 4M lookups in 2^24 keys),
+		and it takes only key bytes, while VanEmdeBoas pads up to 2n keys.
+		VanEmdeBoas is kept for searches without prefetching(or with costly blocks,
+		as pages of mapped file), where its O(log_B n) block transfers matter.
+	Key array and tables are allocated from memory resource given on construction.
+*/
+
+/*
+	Bytes taken by FrozenBTree(see FrozenBTree::memoryUsage):
+		keyBytes - key array with padding of layout,
+		tableBytes - van Emde Boas position tables,
+		slackBytes - reserved but not used parts of these arrays.
+*/
+struct FrozenBTreeMemoryUsage
+{
+	size_t keyBytes;
+	size_t tableBytes;
+	size_t slackBytes;
+	inline size_t total() const { return keyBytes + tableBytes + slackBytes; }
+};
+
+template<typename Key>
+class FrozenBTree
+{
+public:
+	enum class Layout { Eytzinger, VanEmdeBoas };
+	// keys must be sorted
+	template<typename InputIt>
+	FrozenBTree(InputIt first, InputIt last, Layout _layout, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	// Eytzinger for every size(see comment of class)
+	static Layout defaultLayout(size_t keysCount);
+
+	bool contains(const Key& key) const;
+	// first key which is not less than key, nullptr if there is no such one
+	const Key* lowerBound(const Key& key) const;
+	inline size_t size() const { return count; }
+	inline Layout getLayout() const { return layout; }
+	FrozenBTreeMemoryUsage memoryUsage() const;
+	// arrays are built with exact sizes, it matters only for copies of them
+	void shrinkToFit();
+	inline std::pmr::memory_resource* getResource() const { return keys.get_allocator().resource(); }
+private:
+	void buildEytzinger(const std::vector<Key>& sorted, size_t& next, size_t i);
+	void buildVanEmdeBoas(const std::vector<Key>& sorted);
+	void splitVanEmdeBoas(int top, int height);
+	size_t lowerBoundEytzinger(const Key& key) const;
+	size_t lowerBoundVanEmdeBoas(const Key& key) const;
+
+	static constexpr size_t NotFound = ~size_t(0);
+	std::pmr::vector<Key> keys;
+	// van Emde Boas tables for node of depth d, which is root of bottom tree:
+	//		topSizes[d] - size of top tree over it(also mask for index in bottom trees),
+	//		bottomSizes[d] - size of its bottom tree, topDepths[d] - depth of top tree's root
+	std::pmr::vector<size_t> topSizes;
+	std::pmr::vector<size_t> bottomSizes;
+	std::pmr::vector<int> topDepths;
+	size_t count;
+	int height;
+	Layout layout;
+};
+
+template<typename Key>
+template<typename InputIt>
+FrozenBTree<Key>::FrozenBTree(InputIt first, InputIt last, Layout _layout, std::pmr::memory_resource* _resource)
+	: keys(_resource), topSizes(_resource), bottomSizes(_resource), topDepths(_resource), count{ 0 }, height{ 0 }, layout{ _layout }
+{
+	std::vector<Key> sorted(first, last);
+	count = sorted.size();
+	if (layout == Layout::Eytzinger)
+	{
+		// 1-based, keys[0] is not used
+		keys.resize(count + 1);
+		size_t next = 0;
+		buildEytzinger(sorted, next, 1);
+	}
+	else
+	{
+		buildVanEmdeBoas(sorted);
+	}
+}
+
+template<typename Key>
+typename FrozenBTree<Key>::Layout FrozenBTree<Key>::defaultLayout(size_t keysCount)
+{
+	(void)keysCount;
+	return Layout::Eytzinger;
+}
+
+template<typename Key>
+bool FrozenBTree<Key>::contains(const Key& key) const
+{
+	const Key* found = lowerBound(key);
+	return found && !(key < *found);
+}
+
+template<typename Key>
+const Key* FrozenBTree<Key>::lowerBound(const Key& key) const
+{
+	size_t position = (layout == Layout::Eytzinger) ? lowerBoundEytzinger(key) : lowerBoundVanEmdeBoas(key);
+	return (position == NotFound) ? nullptr : &keys[position];
+}
+
+/*
+	In-order walk over implicit tree gives keys in sorted order.
+*/
+template<typename Key>
+void FrozenBTree<Key>::buildEytzinger(const std::vector<Key>& sorted, size_t& next, size_t i)
+{
+	if (i > count)
+	{
+		return;
+	}
+	buildEytzinger(sorted, next, 2 * i);
+	keys[i] = sorted[next++];
+	buildEytzinger(sorted, next, 2 * i + 1);
+}
+
+template<typename Key>
+size_t FrozenBTree<Key>::lowerBoundEytzinger(const Key& key) const
+{
+	size_t candidate = NotFound;
+	size_t i = 1;
+	while (i <= count)
+	{
+		BTREE_PREFETCH(keys.data() + std::min(16 * i, count));
+		bool right = keys[i] < key;
+		candidate = right ? candidate : i;
+		i = 2 * i + right;
+	}
+	return candidate;
+}
+
+/*
+	Node with breadth-first index i(1-based) at depth d has in-order index
+		((2 * (i - 2^d) + 1) << (height - 1 - d)) - 1,
+	its position is computed from position of its ancestor at depth topDepths[d].
+*/
+template<typename Key>
+void FrozenBTree<Key>::buildVanEmdeBoas(const std::vector<Key>& sorted)
+{
+	while (((size_t(1) << height) - 1) < count)
+	{
+		++height;
+	}
+	if (height == 0)
+	{
+		return;
+	}
+	topSizes.assign(height, 0);
+	bottomSizes.assign(height, 0);
+	topDepths.assign(height, 0);
+	splitVanEmdeBoas(0, height);
+	size_t nodes = (size_t(1) << height) - 1;
+	keys.resize(nodes);
+	std::vector<size_t> positions(nodes + 1);
+	positions[1] = 0;
+	for (size_t i = 1; i <= nodes; ++i)
+	{
+		int depth = 0;
+		while ((i >> (depth + 1)) != 0)
+		{
+			++depth;
+		}
+		if (depth > 0)
+		{
+			size_t ancestor = i >> (depth - topDepths[depth]);
+			positions[i] = positions[ancestor] + topSizes[depth] + (i & topSizes[depth]) * bottomSizes[depth];
+		}
+		size_t inOrder = ((2 * (i - (size_t(1) << depth)) + 1) << (height - 1 - depth)) - 1;
+		keys[positions[i]] = sorted[std::min(inOrder, count - 1)];
+	}
+}
+
+/*
+	Top tree gets lower half of height, bottom trees get the rest.
+*/
+template<typename Key>
+void FrozenBTree<Key>::splitVanEmdeBoas(int top, int subtreeHeight)
+{
+	if (subtreeHeight <= 1)
+	{
+		return;
+	}
+	int topHeight = subtreeHeight / 2;
+	int bottomHeight = subtreeHeight - topHeight;
+	int bottomRoot = top + topHeight;
+	topSizes[bottomRoot] = (size_t(1) << topHeight) - 1;
+	bottomSizes[bottomRoot] = (size_t(1) << bottomHeight) - 1;
+	topDepths[bottomRoot] = top;
+	splitVanEmdeBoas(top, topHeight);
+	splitVanEmdeBoas(bottomRoot, bottomHeight);
+}
+
+template<typename Key>
+size_t FrozenBTree<Key>::lowerBoundVanEmdeBoas(const Key& key) const
+{
+	size_t candidate = NotFound;
+	// positions of nodes on the way
+	size_t path[64];
+	size_t i = 1;
+	for (int depth = 0; depth < height; ++depth)
+	{
+		path[depth] = (depth == 0) ? 0 : path[topDepths[depth]] + topSizes[depth] + (i & topSizes[depth]) * bottomSizes[depth];
+		bool right = keys[path[depth]] < key;
+		candidate = right ? candidate : path[depth];
+		i = 2 * i + right;
+	}
+	return candidate;
+}
+
+template<typename Key>
+FrozenBTreeMemoryUsage FrozenBTree<Key>::memoryUsage() const
+{
+	return FrozenBTreeMemoryUsage{ keys.size() * sizeof(Key),
+		(topSizes.size() + bottomSizes.size()) * sizeof(size_t) + topDepths.size() * sizeof(int),
+		(keys.capacity() - keys.size()) * sizeof(Key) + (topSizes.capacity() - topSizes.size() + bottomSizes.capacity() - bottomSizes.size()) * sizeof(size_t)
+			+ (topDepths.capacity() - topDepths.size()) * sizeof(int) };
+}
+
+template<typename Key>
+void FrozenBTree<Key>::shrinkToFit()
+{
+	keys.shrink_to_fit();
+	topSizes.shrink_to_fit();
+	bottomSizes.shrink_to_fit();
+	topDepths.shrink_to_fit();
+}
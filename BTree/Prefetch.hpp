@@ -0,0 +1,14 @@
+#pragma once
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+/*
+	Hint to start loading cache line of p, it never faults(p can be any address).
+	Used by trees which read several nodes at once(BTree::searchBatch, FrozenBTree).
+*/
+#if defined(_MSC_VER)
+#define BTREE_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define BTREE_PREFETCH(p) __builtin_prefetch(p)
+#endif
@@ -0,0 +1,442 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <memory_resource>
+#include <stdexcept>
+#include "BTree.hpp"
+
+/*
+	Range-partitioned index: one BTree per shard(for example, per NUMA node).
+	Shard s keeps keys from [boundaries[s - 1], boundaries[s]), routing of key is
+		one binary search over boundaries(shards - 1 keys at most, so it stays in cache).
+	Every shard has:
+		its own memory resource - all nodes of its tree are allocated from it, so with
+			resource which allocates on memory of some NUMA node, tree is local to this node;
+		its own copy of routing table(in its memory), so threads of every node route
+			keys without touching remote memory(see localShard arguments).
+	containsBatch routes keys and searches every shard's part on worker thread of this shard.
+		Workers are started once with tree, placeThread is called once on every worker
+		to bind it to shard's node(with numa_run_on_node, SetThreadGroupAffinity, ...),
+		so lookups run near their memory and batches do not pay for thread creation.
+	Rebalancing moves boundaries to split keys to equal parts:
+		moved ranges are cut with BTree::split and attached with BTree::join(O(height)),
+		and only moved keys are copied to memory of their new shard(BTree::clone).
+		It is done by insert/erase, when some shard grows maxImbalance times bigger
+		than average(0 - only by explicit rebalance()).
+	As BTree, it is not thread-safe for changes: lookups can go concurrently,
+		but not together with insert/erase/rebalance(concurrent containsBatch calls
+		take workers in turn).
+	Tree with workers can be moved, but not copied.
+*/
+
+/*
+	Bytes taken by ShardedBTree(see ShardedBTree::memoryUsage):
+		trees - memory of shard trees,
+		routeBytes - replicas of routing table(with their spare capacity).
+*/
+struct ShardedBTreeMemoryUsage
+{
+	BTreeMemoryUsage trees;
+	size_t routeBytes;
+	inline size_t total() const { return trees.total() + routeBytes; }
+};
+
+//----ShardWorkers
+
+/*
+	One persistent thread per shard. run gives the same task to workers of chosen
+		shards and waits until all of them have finished it.
+*/
+class ShardWorkers
+{
+public:
+	typedef std::function<void(size_t shard)> Task;
+	typedef std::function<void(size_t shard)> ThreadPlacement;
+
+	ShardWorkers(size_t shards, const ThreadPlacement& placeThread);
+	ShardWorkers(const ShardWorkers&) = delete;
+	ShardWorkers& operator=(const ShardWorkers&) = delete;
+	~ShardWorkers();
+	// task(shard) for every shard with wanted[shard], first exception of task is rethrown
+	void run(const std::vector<char>& wanted, const Task& task);
+private:
+	void loop(size_t shard, ThreadPlacement placeThread);
+
+	// only one run at a time
+	std::mutex runMutex;
+	std::mutex mutex;
+	std::condition_variable taskReady;
+	std::condition_variable taskDone;
+	const Task* task;
+	// 1 for workers which have not taken current task yet
+	std::vector<char> pending;
+	size_t unfinished;
+	std::exception_ptr failure;
+	bool stopping;
+	std::vector<std::thread> threads;
+};
+
+inline ShardWorkers::ShardWorkers(size_t shards, const ThreadPlacement& placeThread)
+	: task{ nullptr }, pending(shards, 0), unfinished{ 0 }, stopping{ false }
+{
+	threads.reserve(shards);
+	for (size_t shard = 0; shard < shards; ++shard)
+	{
+		threads.emplace_back(&ShardWorkers::loop, this, shard, placeThread);
+	}
+}
+
+inline ShardWorkers::~ShardWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskReady.notify_all();
+	for (std::thread& worker : threads)
+	{
+		worker.join();
+	}
+}
+
+inline void ShardWorkers::run(const std::vector<char>& wanted, const Task& _task)
+{
+	std::lock_guard<std::mutex> runLock(runMutex);
+	std::unique_lock<std::mutex> lock(mutex);
+	task = &_task;
+	failure = nullptr;
+	pending = wanted;
+	unfinished = std::count(wanted.begin(), wanted.end(), 1);
+	taskReady.notify_all();
+	taskDone.wait(lock, [this] { return unfinished == 0; });
+	task = nullptr;
+	if (failure)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+inline void ShardWorkers::loop(size_t shard, ThreadPlacement placeThread)
+{
+	if (placeThread)
+	{
+		placeThread(shard);
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		taskReady.wait(lock, [this, shard] { return stopping || pending[shard]; });
+		if (stopping)
+		{
+			return;
+		}
+		pending[shard] = 0;
+		lock.unlock();
+		std::exception_ptr error;
+		try
+		{
+			(*task)(shard);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		lock.lock();
+		if (error && !failure)
+		{
+			failure = error;
+		}
+		if (--unfinished == 0)
+		{
+			taskDone.notify_one();
+		}
+	}
+}
+
+//----/ShardWorkers
+
+template<typename Key>
+class ShardedBTree
+{
+public:
+	typedef ShardWorkers::ThreadPlacement ThreadPlacement;
+
+	// one shard per resource
+	ShardedBTree(int _minDegree, const std::vector<std::pmr::memory_resource*>& resources, double _maxImbalance = 1.5,
+		ThreadPlacement _placeThread = ThreadPlacement());
+	// shards with default resource
+	ShardedBTree(int _minDegree, size_t shardsCount, double _maxImbalance = 1.5);
+
+	inline size_t size() const { return count; }
+	inline size_t shardsCount() const { return shards.size(); }
+	inline size_t shardSize(size_t shard) const { return shards[shard].tree.size(); }
+	size_t shardOf(Key key, size_t localShard = 0) const;
+
+	bool contains(Key key, size_t localShard = 0);
+	void insert(Key key, size_t localShard = 0);
+	void erase(Key key, size_t localShard = 0);
+	// result i is 1 if keys[i] is in index, every shard is searched on its own thread
+	std::vector<char> containsBatch(const std::vector<Key>& keys, size_t localShard = 0);
+	// returns true if boundaries were moved
+	bool rebalance();
+	// all shards together, or only memory of one shard(in its resource)
+	ShardedBTreeMemoryUsage memoryUsage() const;
+	ShardedBTreeMemoryUsage shardMemoryUsage(size_t shard) const;
+	void shrinkToFit();
+	inline std::pmr::memory_resource* getResource(size_t shard) const { return shards[shard].tree.getResource(); }
+private:
+	struct Shard
+	{
+		Shard(int minDegree, std::pmr::memory_resource* resource)
+			: tree(minDegree, resource), routes(resource) {}
+		BTree<Key> tree;
+		// replica of boundaries
+		std::pmr::vector<Key> routes;
+	};
+	bool isImbalanced(size_t shard) const;
+	void moveToShard(BTree<Key>& piece, size_t shard, bool toEnd);
+	void setBoundaries(const std::vector<Key>& newBoundaries);
+
+	int minDegree;
+	double maxImbalance;
+	std::vector<Shard> shards;
+	// shard s - [boundaries[s - 1], boundaries[s]), shards after boundaries.size() are empty
+	std::vector<Key> boundaries;
+	size_t count;
+	std::unique_ptr<ShardWorkers> workers;
+};
+
+template<typename Key>
+ShardedBTree<Key>::ShardedBTree(int _minDegree, const std::vector<std::pmr::memory_resource*>& resources, double _maxImbalance,
+	ThreadPlacement _placeThread)
+	: minDegree{ _minDegree }, maxImbalance{ _maxImbalance }, count{ 0 }
+{
+	if (resources.empty())
+	{
+		throw std::invalid_argument("ShardedBTree: no shards");
+	}
+	shards.reserve(resources.size());
+	for (std::pmr::memory_resource* resource : resources)
+	{
+		shards.emplace_back(minDegree, resource);
+	}
+	workers.reset(new ShardWorkers(shards.size(), _placeThread));
+}
+
+template<typename Key>
+ShardedBTree<Key>::ShardedBTree(int _minDegree, size_t shardsCount, double _maxImbalance)
+	: ShardedBTree(_minDegree, std::vector<std::pmr::memory_resource*>(shardsCount, std::pmr::get_default_resource()), _maxImbalance)
+{
+}
+
+/*
+	Routing uses replica of routing table of localShard.
+*/
+template<typename Key>
+size_t ShardedBTree<Key>::shardOf(Key key, size_t localShard) const
+{
+	const std::pmr::vector<Key>& routes = shards[localShard].routes;
+	return std::upper_bound(routes.begin(), routes.end(), key) - routes.begin();
+}
+
+template<typename Key>
+bool ShardedBTree<Key>::contains(Key key, size_t localShard)
+{
+	return shards[shardOf(key, localShard)].tree.search(key) != nullptr;
+}
+
+template<typename Key>
+void ShardedBTree<Key>::insert(Key key, size_t localShard)
+{
+	size_t shard = shardOf(key, localShard);
+	shards[shard].tree.insert(key);
+	++count;
+	if (isImbalanced(shard))
+	{
+		rebalance();
+	}
+}
+
+template<typename Key>
+void ShardedBTree<Key>::erase(Key key, size_t localShard)
+{
+	size_t shard = shardOf(key, localShard);
+	size_t before = shards[shard].tree.size();
+	shards[shard].tree.erase(key);
+	count -= before - shards[shard].tree.size();
+	// other shards could become too big relatively to average
+	for (size_t s = 0; s < shards.size(); ++s)
+	{
+		if (isImbalanced(s))
+		{
+			rebalance();
+			break;
+		}
+	}
+}
+
+/*
+	Keys are grouped by shards, then every group is searched with BTree::searchBatch
+		on worker of its shard, current thread waits for all of them.
+*/
+template<typename Key>
+std::vector<char> ShardedBTree<Key>::containsBatch(const std::vector<Key>& keys, size_t localShard)
+{
+	std::vector<std::vector<size_t>> positions(shards.size());
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		positions[shardOf(keys[i], localShard)].push_back(i);
+	}
+	std::vector<char> found(keys.size(), 0);
+	ShardWorkers::Task searchShard = [this, &keys, &positions, &found](size_t shard)
+	{
+		std::vector<Key> shardKeys;
+		shardKeys.reserve(positions[shard].size());
+		for (size_t i : positions[shard])
+		{
+			shardKeys.push_back(keys[i]);
+		}
+		auto results = shards[shard].tree.searchBatch(shardKeys);
+		for (size_t j = 0; j < results.size(); ++j)
+		{
+			found[positions[shard][j]] = results[j] != nullptr;
+		}
+	};
+	std::vector<char> wanted(shards.size(), 0);
+	for (size_t shard = 0; shard < shards.size(); ++shard)
+	{
+		wanted[shard] = !positions[shard].empty();
+	}
+	workers->run(wanted, searchShard);
+	return found;
+}
+
+template<typename Key>
+bool ShardedBTree<Key>::isImbalanced(size_t shard) const
+{
+	return maxImbalance > 0 && count >= shards.size() * size_t(2 * minDegree)
+		&& shards[shard].tree.size() > maxImbalance * count / shards.size();
+}
+
+/*
+	New boundary i is key with global rank count * (i + 1) / shards.
+	Boundaries are moved from left to right, and shard i gets its new range:
+		1. it has keys which are not less than new boundary - they are cut with split
+			and attached to the beginning of shard i + 1;
+		2. it needs keys which are less than new boundary - they are cut from the beginning
+			of next shards(some of them can give all their keys) and attached to its end.
+*/
+template<typename Key>
+bool ShardedBTree<Key>::rebalance()
+{
+	size_t shardsNumber = shards.size();
+	if (shardsNumber < 2 || count < shardsNumber)
+	{
+		return false;
+	}
+	// global rank -> shard and rank in it
+	std::vector<Key> newBoundaries;
+	for (size_t i = 1, shard = 0, skipped = 0; i < shardsNumber; ++i)
+	{
+		size_t rank = count * i / shardsNumber;
+		while (rank - skipped >= shards[shard].tree.size())
+		{
+			skipped += shards[shard].tree.size();
+			++shard;
+		}
+		newBoundaries.push_back(shards[shard].tree.select(rank - skipped));
+	}
+	if (newBoundaries == boundaries)
+	{
+		return false;
+	}
+	for (size_t i = 0; i + 1 < shardsNumber; ++i)
+	{
+		Key boundary = newBoundaries[i];
+		if (i >= boundaries.size() || boundary < boundaries[i])
+		{
+			BTree<Key> piece = shards[i].tree.split(boundary);
+			moveToShard(piece, i + 1, false);
+		}
+		else
+		{
+			for (size_t j = i + 1; j < shardsNumber; ++j)
+			{
+				BTree<Key> rest = shards[j].tree.split(boundary);
+				BTree<Key> piece = shards[j].tree;
+				shards[j].tree = rest;
+				moveToShard(piece, i, true);
+				// shard j has given all its keys - boundary can be in next shards
+				if (rest.size() != 0 || j >= boundaries.size() || !(boundaries[j] < boundary))
+				{
+					break;
+				}
+			}
+		}
+	}
+	setBoundaries(newBoundaries);
+	return true;
+}
+
+/*
+	Piece is copied to memory of shard(if it is not there yet) and joined with its tree.
+*/
+template<typename Key>
+void ShardedBTree<Key>::moveToShard(BTree<Key>& piece, size_t shard, bool toEnd)
+{
+	BTree<Key>& tree = shards[shard].tree;
+	if (piece.getResource() != tree.getResource())
+	{
+		piece = piece.clone(tree.getResource());
+	}
+	tree = toEnd ? BTree<Key>::join(tree, piece) : BTree<Key>::join(piece, tree);
+}
+
+template<typename Key>
+ShardedBTreeMemoryUsage ShardedBTree<Key>::memoryUsage() const
+{
+	ShardedBTreeMemoryUsage usage{ BTreeMemoryUsage{ 0, 0, 0, 0, 0 }, 0 };
+	for (size_t shard = 0; shard < shards.size(); ++shard)
+	{
+		ShardedBTreeMemoryUsage shardUsage = shardMemoryUsage(shard);
+		usage.trees.nodes += shardUsage.trees.nodes;
+		usage.trees.nodeBytes += shardUsage.trees.nodeBytes;
+		usage.trees.keyBytes += shardUsage.trees.keyBytes;
+		usage.trees.childBytes += shardUsage.trees.childBytes;
+		usage.trees.slackBytes += shardUsage.trees.slackBytes;
+		usage.routeBytes += shardUsage.routeBytes;
+	}
+	return usage;
+}
+
+template<typename Key>
+ShardedBTreeMemoryUsage ShardedBTree<Key>::shardMemoryUsage(size_t shard) const
+{
+	return ShardedBTreeMemoryUsage{ shards[shard].tree.memoryUsage(), shards[shard].routes.capacity() * sizeof(Key) };
+}
+
+template<typename Key>
+void ShardedBTree<Key>::shrinkToFit()
+{
+	for (Shard& shard : shards)
+	{
+		shard.tree.shrinkToFit();
+		shard.routes.shrink_to_fit();
+	}
+}
+
+template<typename Key>
+void ShardedBTree<Key>::setBoundaries(const std::vector<Key>& newBoundaries)
+{
+	boundaries = newBoundaries;
+	for (Shard& shard : shards)
+	{
+		shard.routes.assign(boundaries.begin(), boundaries.end());
+	}
+}
@@ -0,0 +1,520 @@
+#pragma once
+#include <cstdio>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include "heap.hpp"
+#include "kWayMerge.hpp"
+
+/*
+    External-memory min priority queue for queues that do not fit in RAM.
+    Layout (simplified sequence heap):
+        1. insertion heap - ordinary MinHeap with at most memoryItems items;
+        2. runs - sorted files on disk, every run is read sequentially block by block;
+        3. deletion buffer - MinHeap with current head of every run.
+    When insertion heap is full, it is spilled to disk as new sorted run of level 0.
+    When some level gets fanIn runs, they are merged to one run of next level,
+        so every item is rewritten only log_{M/B}(N/M) times and extractMin
+        costs amortized O((1/B) log_{M/B}(N/B)) I/Os.
+    T must be trivially copyable, because it is written to files as raw bytes.
+    Failed writes(full disk, file size limits) and runs read back shorter than
+        they were written throw HeapException, after it heap can be only destroyed.
+    Both heaps, run readers and their blocks are allocated from memory resource given
+        on construction(buffers of FILE are allocated by stdio).
+*/
+
+/*
+    Bytes taken by ExternalMinHeap in memory(see ExternalMinHeap::memoryUsage):
+        heapBytes - items of insertion heap and heads in deletion buffer,
+        blockBytes - read blocks of all runs,
+        runBytes - run readers and list of runs,
+        slackBytes - reserved but not used parts of heaps and list of runs.
+    Items on disk are not counted.
+*/
+struct ExternalHeapMemoryUsage
+{
+    size_t heapBytes;
+    size_t blockBytes;
+    size_t runBytes;
+    size_t slackBytes;
+    size_t total() const {return heapBytes + blockBytes + runBytes + slackBytes;}
+};
+
+//------------------------------------------RUN FILES
+
+template<typename T>
+class ExternalRunWriter
+{
+public:
+    ExternalRunWriter(const std::string& path, size_t blockItems, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    // run which was not closed is not complete, so its file is removed
+    ~ExternalRunWriter();
+    void write(const T& item);
+    // run is on disk only if close did not throw
+    void close();
+    size_t itemsWritten() const {return written;}
+private:
+    void flush();
+    std::string path;
+    std::FILE* file;
+    std::pmr::vector<T> block;
+    size_t written;
+};
+
+template<typename T>
+ExternalRunWriter<T>::ExternalRunWriter(const std::string& _path, size_t blockItems, std::pmr::memory_resource* resource)
+    : path{_path}, file{std::fopen(_path.c_str(), "wb")}, block(resource), written{0}
+{
+    if(!file)
+    {
+        throwHeapException("ExternalRunWriter: can not create run file");
+    }
+    block.reserve(blockItems);
+}
+
+template<typename T>
+ExternalRunWriter<T>::~ExternalRunWriter()
+{
+    if(file)
+    {
+        std::fclose(file);
+        std::remove(path.c_str());
+    }
+}
+
+template<typename T>
+void ExternalRunWriter<T>::write(const T& item)
+{
+    block.push_back(item);
+    if(block.size() == block.capacity())
+    {
+        flush();
+    }
+}
+
+template<typename T>
+void ExternalRunWriter<T>::flush()
+{
+    if(!block.empty() && std::fwrite(block.data(), sizeof(T), block.size(), file) != block.size())
+    {
+        throwHeapException("ExternalRunWriter: write failed");
+    }
+    written += block.size();
+    block.clear();
+}
+
+/*
+    fwrite only fills buffer of FILE, so errors of buffered bytes come
+        from fflush and fclose.
+*/
+template<typename T>
+void ExternalRunWriter<T>::close()
+{
+    if(!file)
+    {
+        return;
+    }
+    flush();
+    bool failed = std::fflush(file) != 0 || std::ferror(file) != 0;
+    failed = std::fclose(file) != 0 || failed;
+    file = nullptr;
+    if(failed)
+    {
+        std::remove(path.c_str());
+        throwHeapException("ExternalRunWriter: write failed");
+    }
+}
+
+/*
+    Sequential reader of one sorted run(items - number of items written to it).
+    Keeps current item as head, file is removed when reader is destroyed.
+*/
+template<typename T>
+class ExternalRunReader
+{
+public:
+    ExternalRunReader(const std::string& path, size_t items, size_t blockItems,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ~ExternalRunReader();
+    bool hasHead() const {return pos < block.size();}
+    const T& head() const {return block[pos];}
+    void advance();
+    size_t blockBytes() const {return block.capacity() * sizeof(T);}
+    size_t level;
+private:
+    void fill();
+    std::string path;
+    std::FILE* file;
+    std::pmr::vector<T> block;
+    size_t blockItems;
+    size_t pos;
+    // items which are not read yet
+    size_t remaining;
+};
+
+template<typename T>
+ExternalRunReader<T>::ExternalRunReader(const std::string& _path, size_t items, size_t _blockItems, std::pmr::memory_resource* resource)
+    : level{0}, path{_path}, file{std::fopen(_path.c_str(), "rb")}, block(resource), blockItems{_blockItems}, pos{0}, remaining{items}
+{
+    if(!file)
+    {
+        throwHeapException("ExternalRunReader: can not open run file");
+    }
+    fill();
+}
+
+template<typename T>
+ExternalRunReader<T>::~ExternalRunReader()
+{
+    if(file)
+    {
+        std::fclose(file);
+    }
+    std::remove(path.c_str());
+}
+
+template<typename T>
+void ExternalRunReader<T>::advance()
+{
+    if(++pos == block.size())
+    {
+        fill();
+    }
+}
+
+/*
+    Run must give exactly as many items as were written to it.
+*/
+template<typename T>
+void ExternalRunReader<T>::fill()
+{
+    size_t wanted = std::min(blockItems, remaining);
+    block.resize(wanted);
+    size_t got = file ? std::fread(block.data(), sizeof(T), wanted, file) : 0;
+    block.resize(got);
+    pos = 0;
+    remaining -= got;
+    // run is exhausted(or broken) - closing file as soon as possible
+    if((remaining == 0 || got < wanted) && file)
+    {
+        std::fclose(file);
+        file = nullptr;
+    }
+    if(got < wanted)
+    {
+        std::remove(path.c_str());
+        throwHeapException("ExternalRunReader: run file is shorter than written run");
+    }
+}
+
+//------------------------------------------/RUN FILES
+
+//------------------------------------------EXTERNAL MIN HEAP
+
+template<typename T>
+class ExternalMinHeap
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ExternalMinHeap: T must be trivially copyable");
+    typedef ExternalRunReader<T> Run;
+    // run readers are freed to memory resource they were allocated from
+    struct RunDeleter
+    {
+        std::pmr::memory_resource* resource;
+        void operator()(Run* run) const;
+    };
+    typedef std::unique_ptr<Run, RunDeleter> pRun;
+    // head of run and index of this run
+    typedef std::pair<T, size_t> RunHead;
+public:
+    /*
+        memoryItems - capacity of insertion heap(M),
+        blockItems - size of one I/O block(B),
+        tempDir - directory for run files.
+    */
+    ExternalMinHeap(size_t memoryItems, const std::string& tempDir = ".", size_t blockItems = 4096,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ExternalMinHeap(const ExternalMinHeap&) = delete;
+    ExternalMinHeap& operator=(const ExternalMinHeap&) = delete;
+    void insert(const T& item);
+    const T& minimum() const;
+    T extractMin();
+    bool tryPop(T& out);
+    size_t size() const {return count;}
+    bool empty() const {return count == 0;}
+    size_t runsCount() const {return runs.size();}
+    ExternalHeapMemoryUsage memoryUsage() const;
+    // drops exhausted runs and gives back spare capacity of heaps
+    void shrinkToFit();
+    std::pmr::memory_resource* getResource() const {return resource;}
+private:
+    bool minimumInRuns() const;
+    void spill();
+    void mergeLevel(size_t level);
+    void rebuildDeletionBuffer();
+    std::string nextRunPath();
+    pRun newRun(const std::string& path, size_t items);
+    MinHeap<T> insertionHeap;
+    MinHeap<RunHead> deletionBuffer;
+    std::pmr::vector<pRun> runs;
+    std::string tempDir;
+    size_t memoryItems;
+    size_t blockItems;
+    size_t fanIn;
+    size_t count;
+    size_t runsCreated;
+    std::pmr::memory_resource* resource;
+};
+
+template<typename T>
+ExternalMinHeap<T>::ExternalMinHeap(size_t _memoryItems, const std::string& _tempDir, size_t _blockItems,
+    std::pmr::memory_resource* _resource)
+    : insertionHeap(_resource), deletionBuffer(_resource), runs(_resource), tempDir{_tempDir},
+      memoryItems{std::max<size_t>(_memoryItems, 1)}, blockItems{std::max<size_t>(_blockItems, 1)},
+      fanIn{std::max<size_t>(memoryItems / blockItems, 2)}, count{0}, runsCreated{0}, resource{_resource}
+{
+}
+
+template<typename T>
+void ExternalMinHeap<T>::RunDeleter::operator()(Run* run) const
+{
+    run->~Run();
+    resource->deallocate(run, sizeof(Run), alignof(Run));
+}
+
+/*
+    Reader of written run in memory of resource of heap.
+*/
+template<typename T>
+typename ExternalMinHeap<T>::pRun ExternalMinHeap<T>::newRun(const std::string& path, size_t items)
+{
+    void* memory = resource->allocate(sizeof(Run), alignof(Run));
+    try
+    {
+        return pRun(new (memory) Run(path, items, blockItems, resource), RunDeleter{resource});
+    }
+    catch(...)
+    {
+        resource->deallocate(memory, sizeof(Run), alignof(Run));
+        throw;
+    }
+}
+
+template<typename T>
+void ExternalMinHeap<T>::insert(const T& item)
+{
+    if(insertionHeap.size() >= memoryItems)
+    {
+        spill();
+    }
+    insertionHeap.insert(item);
+    ++count;
+}
+
+// true if smallest item is head of some run, not in insertion heap
+template<typename T>
+bool ExternalMinHeap<T>::minimumInRuns() const
+{
+    if(deletionBuffer.empty())
+    {
+        return false;
+    }
+    return insertionHeap.empty() || deletionBuffer.top().first < insertionHeap.top();
+}
+
+template<typename T>
+const T& ExternalMinHeap<T>::minimum() const
+{
+    return minimumInRuns() ? deletionBuffer.top().first : insertionHeap.top();
+}
+
+template<typename T>
+T ExternalMinHeap<T>::extractMin()
+{
+    T heapMin;
+    if(!tryPop(heapMin))
+    {
+        throwHeapException("ExternalMinHeap::extractMin(): heap is empty");
+    }
+    return heapMin;
+}
+
+template<typename T>
+bool ExternalMinHeap<T>::tryPop(T& out)
+{
+    if(count == 0)
+    {
+        return false;
+    }
+    if(minimumInRuns())
+    {
+        size_t runIndex = deletionBuffer.top().second;
+        out = deletionBuffer.top().first;
+        Run& run = *runs[runIndex];
+        run.advance();
+        // next head of the same run takes place of popped one with one sift
+        if(run.hasHead())
+        {
+            deletionBuffer.replaceTop(RunHead{run.head(), runIndex});
+        }
+        else
+        {
+            RunHead exhausted;
+            deletionBuffer.tryPop(exhausted);
+        }
+    }
+    else if(!insertionHeap.tryPop(out))
+    {
+        return false;
+    }
+    --count;
+    return true;
+}
+
+/*
+    Writes whole insertion heap to disk as new sorted run.
+    Merges levels which became full after that.
+*/
+template<typename T>
+void ExternalMinHeap<T>::spill()
+{
+    std::string path = nextRunPath();
+    ExternalRunWriter<T> writer(path, blockItems, resource);
+    T item;
+    while(insertionHeap.tryPop(item))
+    {
+        writer.write(item);
+    }
+    writer.close();
+    runs.push_back(newRun(path, writer.itemsWritten()));
+    size_t level = 0;
+    for(;;)
+    {
+        size_t onLevel = std::count_if(runs.begin(), runs.end(),
+            [level](const pRun& run) {return run->level == level;});
+        if(onLevel < fanIn)
+        {
+            break;
+        }
+        mergeLevel(level);
+        ++level;
+    }
+    rebuildDeletionBuffer();
+}
+
+/*
+    Multiway merge of all runs on level to one run on level + 1.
+    Every run is read and new run is written strictly sequentially,
+        LoserTree takes one leaf-to-root pass per written item.
+*/
+template<typename T>
+void ExternalMinHeap<T>::mergeLevel(size_t level)
+{
+    std::pmr::vector<pRun> merging(resource);
+    std::pmr::vector<pRun> rest(resource);
+    for(pRun& run : runs)
+    {
+        (run->level == level ? merging : rest).push_back(std::move(run));
+    }
+    LoserTree<T> heads(merging.size());
+    for(size_t i = 0; i < merging.size(); ++i)
+    {
+        if(merging[i]->hasHead())
+        {
+            heads.setLeaf(i, merging[i]->head());
+        }
+    }
+    heads.build();
+    std::string path = nextRunPath();
+    ExternalRunWriter<T> writer(path, blockItems, resource);
+    while(!heads.empty())
+    {
+        writer.write(heads.top());
+        Run& run = *merging[heads.winner()];
+        run.advance();
+        if(run.hasHead())
+        {
+            heads.replaceTop(run.head());
+        }
+        else
+        {
+            heads.exhaustTop();
+        }
+    }
+    writer.close();
+    // old run files are removed here
+    merging.clear();
+    rest.push_back(newRun(path, writer.itemsWritten()));
+    rest.back()->level = level + 1;
+    runs = std::move(rest);
+}
+
+// run indices have changed - collecting heads again
+template<typename T>
+void ExternalMinHeap<T>::rebuildDeletionBuffer()
+{
+    std::vector<RunHead> heads;
+    std::pmr::vector<pRun> alive(resource);
+    for(pRun& run : runs)
+    {
+        if(run->hasHead())
+        {
+            heads.push_back(RunHead{run->head(), alive.size()});
+            alive.push_back(std::move(run));
+        }
+    }
+    runs = std::move(alive);
+    deletionBuffer = MinHeap<RunHead>::buildMinHeap(heads, resource);
+}
+
+template<typename T>
+ExternalHeapMemoryUsage ExternalMinHeap<T>::memoryUsage() const
+{
+    HeapMemoryUsage insertion = insertionHeap.memoryUsage();
+    HeapMemoryUsage deletion = deletionBuffer.memoryUsage();
+    ExternalHeapMemoryUsage usage{insertion.used + deletion.used, 0, runs.size() * (sizeof(pRun) + sizeof(Run)),
+        insertion.slack + deletion.slack + (runs.capacity() - runs.size()) * sizeof(pRun)};
+    for(const pRun& run : runs)
+    {
+        usage.blockBytes += run->blockBytes();
+    }
+    return usage;
+}
+
+/*
+    Exhausted runs stay in list until next spill, rebuilding deletion buffer drops them.
+*/
+template<typename T>
+void ExternalMinHeap<T>::shrinkToFit()
+{
+    rebuildDeletionBuffer();
+    insertionHeap.shrinkToFit();
+    deletionBuffer.shrinkToFit();
+    runs.shrink_to_fit();
+}
+
+/*
+    Process id keeps heaps of different processes in the same tempDir apart
+    (addresses of heaps can be equal in them).
+*/
+template<typename T>
+std::string ExternalMinHeap<T>::nextRunPath()
+{
+#if defined(_WIN32)
+    long processId = _getpid();
+#else
+    long processId = getpid();
+#endif
+    char name[96];
+    std::snprintf(name, sizeof(name), "/extheap_%ld_%p_%zu.run", processId, static_cast<void*>(this), runsCreated++);
+    return tempDir + name;
+}
+
+//------------------------------------------/EXTERNAL MIN HEAP
@@ -1,8 +1,19 @@
+#pragma once
 #include <vector>
 #include <cmath>
 #include <string>
 #include <limits>
 #include <algorithm>
+#include <utility>
+#include <functional>
+#include <memory_resource>
+
+// throwing paths are kept out of line, so they do not stop hot methods from inlining
+#if defined(_MSC_VER)
+#define HEAP_COLD __declspec(noinline)
+#else
+#define HEAP_COLD __attribute__((noinline, cold))
+#endif
 
 class HeapException
 {
@@ -14,43 +25,74 @@ private:
     std::string exc;
 };
 
+[[noreturn]] HEAP_COLD inline void throwHeapException(const char* descr)
+{
+    throw HeapException{descr};
+}
+
 //------------------------------------------HEAP
 
+/*
+    Bytes taken by heap array: used - by elements, slack - by reserved capacity.
+*/
+struct HeapMemoryUsage
+{
+    size_t used;
+    size_t slack;
+    size_t total() const {return used + slack;}
+};
+
+/*
+    Elements are allocated from memory resource given on construction
+    (so heap can be put into its own arena), default one is new/delete.
+*/
 template<typename T>
 class Heap
 {
 public:
-    using Elements = std::vector<T>;
+    using Elements = std::pmr::vector<T>;
     using Index = size_t;
-    T item(Index i);
-    Index indexOf(T val);
+    explicit Heap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : elements(resource) {}
+    const T& item(Index i) const;
+    Index indexOf(const T& val) const;
     size_t size() const {return elements.size();}
+    bool empty() const {return elements.empty();}
+    HeapMemoryUsage memoryUsage() const;
+    // gives back slack of heap array
+    void shrinkToFit() {elements.shrink_to_fit();}
 protected:
-    Index parent(Index i);
-    Index left(Index i);
-    Index right(Index i);
+    static Index parent(Index i);
+    static Index left(Index i);
+    static Index right(Index i);
     Elements elements;
 };
 
 template<typename T>
-T Heap<T>::item(Index i)
+const T& Heap<T>::item(Index i) const
 {
     return elements[i];
 }
 
 template<typename T>
-typename Heap<T>::Index Heap<T>::indexOf(T val)
+typename Heap<T>::Index Heap<T>::indexOf(const T& val) const
 {
     // find is O(n) for vector
     auto iter = std::find(elements.begin(), elements.end(), val);
     if(iter == elements.end())
     {
-        throw HeapException("Heap::indexOf(): not found");
+        throwHeapException("Heap::indexOf(): not found");
     }
     // distance is O(1) for vector
     return std::distance(elements.begin(), iter);
 }
 
+template<typename T>
+HeapMemoryUsage Heap<T>::memoryUsage() const
+{
+    return HeapMemoryUsage{elements.size() * sizeof(T), (elements.capacity() - elements.size()) * sizeof(T)};
+}
+
 template<typename T>
 typename Heap<T>::Index Heap<T>::parent(Index i)
 {
@@ -77,93 +119,148 @@ template<typename T>
 class MaxHeap : public Heap<T>
 {
 public:
-    MaxHeap() : Heap<T>() {}
-    using Elements = std::vector<T>;
+    explicit MaxHeap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : Heap<T>(resource) {}
+    using Elements = std::pmr::vector<T>;
     using Index = size_t;
     void maxHeapify(Index i);
     void insert(const T& item);
-    T maximum();
+    const T& top() const {return this->elements[0];}
+    const T& maximum() const {return top();}
     T extractMax();
+    bool tryPop(T& out);
+    void replaceTop(const T& item);
     void increaseKey(Index i, T incr);
+    bool tryIncreaseKey(Index i, T incr);
 
     template<typename Container>
-    static MaxHeap buildMaxHeap(Container& container);
+    static MaxHeap buildMaxHeap(Container& container, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+private:
+    void siftUp(Index i);
 };
 
+/*
+    Iterative sift down.
+    Moved item is kept aside and only written once, when its place is found,
+    so every level costs one move instead of a swap.
+*/
 template<typename T>
 void MaxHeap<T>::maxHeapify(Index i)
 {
-    Index l = this->left(i);
-    Index r = this->right(i);
-    Index largest;
-    if(l < this->elements.size() && this->elements[l] > this->elements[i])
+    const Index sz = this->elements.size();
+    if(this->left(i) >= sz)
     {
-        largest = l;
+        return;
     }
-    else
+    T moving = std::move(this->elements[i]);
+    Index child;
+    while((child = this->left(i)) < sz)
     {
-        largest = i;
+        // picking the largest child without a separate branch for the right one
+        child += (child + 1 < sz && this->elements[child + 1] > this->elements[child]);
+        if(!(this->elements[child] > moving))
+        {
+            break;
+        }
+        this->elements[i] = std::move(this->elements[child]);
+        i = child;
     }
-    if(r < this->elements.size() && this->elements[r] > this->elements[largest])
-    {
-        largest = r;
-    }
-    if(largest != i)
+    this->elements[i] = std::move(moving);
+}
+
+template<typename T>
+void MaxHeap<T>::siftUp(Index i)
+{
+    T moving = std::move(this->elements[i]);
+    // moving new key up
+    while(i > 0 && this->elements[this->parent(i)] < moving)
     {
-        std::swap(this->elements[i], this->elements[largest]);
-        maxHeapify(largest);
+        this->elements[i] = std::move(this->elements[this->parent(i)]);
+        i = this->parent(i);
     }
+    this->elements[i] = std::move(moving);
 }
 
 template<typename T>
 void MaxHeap<T>::insert(const T& item)
 {
-    this->elements.push_back(std::numeric_limits<T>::min());
-    increaseKey(this->elements.size() - 1, item);
+    this->elements.push_back(item);
+    siftUp(this->elements.size() - 1);
 }
 
 template<typename T>
-T MaxHeap<T>::maximum()
+T MaxHeap<T>::extractMax()
 {
-    return this->elements[0];
+    if(this->elements.empty())
+    {
+        throwHeapException("MaxHeap::extractMax(): heap is empty");
+    }
+    T heapMax = std::move(this->elements[0]);
+    this->elements[0] = std::move(this->elements.back());
+    this->elements.pop_back();
+    maxHeapify(0);
+    return heapMax;
 }
 
+/*
+    Non-throwing version of extractMax.
+    Returns false (and leaves out untouched) if heap is empty.
+*/
 template<typename T>
-T MaxHeap<T>::extractMax()
+bool MaxHeap<T>::tryPop(T& out)
 {
-    if(this->elements.size() <= 0)      // heap is empty
+    if(this->elements.empty())
     {
-        throw HeapException{"MaxHeap::extractMax(): heap is empty"};
+        return false;
     }
-    T heapMax = maximum();
-    this->elements[0] = this->elements.back();
+    out = std::move(this->elements[0]);
+    this->elements[0] = std::move(this->elements.back());
     this->elements.pop_back();
     maxHeapify(0);
-    return heapMax;
+    return true;
+}
+
+/*
+    Same as extractMax + insert, but with only one sift down.
+    Heap must not be empty.
+*/
+template<typename T>
+void MaxHeap<T>::replaceTop(const T& item)
+{
+    this->elements[0] = item;
+    maxHeapify(0);
 }
 
 template<typename T>
 void MaxHeap<T>::increaseKey(Index i, T incr)
 {
-    if(incr < this->elements[i])
+    if(!tryIncreaseKey(i, std::move(incr)))
     {
-        throw HeapException{"MaxHeap::increaseKey(): new key is not bigger than previous"};
+        throwHeapException("MaxHeap::increaseKey(): new key is not bigger than previous");
     }
-    this->elements[i] = incr;
-    Index curIndex = i;
-    // moving new key up
-    while(curIndex > 0 && (this->elements[this->parent(curIndex)] < this->elements[curIndex]))
+}
+
+/*
+    Non-throwing version of increaseKey.
+    Returns false if new key is smaller than previous one.
+*/
+template<typename T>
+bool MaxHeap<T>::tryIncreaseKey(Index i, T incr)
+{
+    if(incr < this->elements[i])
     {
-        std::swap(this->elements[curIndex], this->elements[this->parent(curIndex)]);
-        curIndex = this->parent(curIndex);
+        return false;
     }
+    this->elements[i] = std::move(incr);
+    siftUp(i);
+    return true;
 }
 
 template<typename T>
 template<typename Container>
-MaxHeap<T> MaxHeap<T>::buildMaxHeap(Container& container)
+MaxHeap<T> MaxHeap<T>::buildMaxHeap(Container& container, std::pmr::memory_resource* resource)
 {
-    MaxHeap<T> newHeap;
+    MaxHeap<T> newHeap(resource);
     newHeap.elements.resize(std::distance(container.begin(), container.end()), T());
     std::move(container.begin(), container.end(), newHeap.elements.begin());
     for(int i = floor(newHeap.elements.size() / 2) - 1; i >= 0; --i)
@@ -181,92 +278,146 @@ template<typename T>
 class MinHeap : public Heap<T>
 {
 public:
-    using Elements = std::vector<T>;
+    explicit MinHeap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : Heap<T>(resource) {}
+    using Elements = std::pmr::vector<T>;
     using Index = size_t;
     void minHeapify(Index i);
     void insert(const T& item);
-    T minimum();
+    const T& top() const {return this->elements[0];}
+    const T& minimum() const {return top();}
     T extractMin();
+    bool tryPop(T& out);
+    void replaceTop(const T& item);
     void decreaseKey(Index i, T decr);
+    bool tryDecreaseKey(Index i, T decr);
 
     template<typename Container>
-    static MinHeap buildMinHeap(Container& container);
+    static MinHeap buildMinHeap(Container& container, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+private:
+    void siftUp(Index i);
 };
 
+/*
+    Iterative sift down, mirror of MaxHeap::maxHeapify.
+*/
 template<typename T>
 void MinHeap<T>::minHeapify(Index i)
 {
-    Index l = this->left(i);
-    Index r = this->right(i);
-    Index smallest;
-    if(l < this->elements.size() && this->elements[l] < this->elements[i])
-    {
-        smallest = l;
-    }
-    else
+    const Index sz = this->elements.size();
+    if(this->left(i) >= sz)
     {
-        smallest = i;
+        return;
     }
-    if(r < this->elements.size() && this->elements[r] < this->elements[smallest])
+    T moving = std::move(this->elements[i]);
+    Index child;
+    while((child = this->left(i)) < sz)
     {
-        smallest = r;
+        // picking the smallest child without a separate branch for the right one
+        child += (child + 1 < sz && this->elements[child + 1] < this->elements[child]);
+        if(!(this->elements[child] < moving))
+        {
+            break;
+        }
+        this->elements[i] = std::move(this->elements[child]);
+        i = child;
     }
-    if(smallest != i)
+    this->elements[i] = std::move(moving);
+}
+
+template<typename T>
+void MinHeap<T>::siftUp(Index i)
+{
+    T moving = std::move(this->elements[i]);
+    // moving new key up
+    while(i > 0 && this->elements[this->parent(i)] > moving)
     {
-        std::swap(this->elements[i], this->elements[smallest]);
-        minHeapify(smallest);
+        this->elements[i] = std::move(this->elements[this->parent(i)]);
+        i = this->parent(i);
     }
+    this->elements[i] = std::move(moving);
 }
 
 template<typename T>
 void MinHeap<T>::insert(const T& item)
 {
-    this->elements.push_back(std::numeric_limits<T>::max());
-    decreaseKey(this->elements.size() - 1, item);
+    this->elements.push_back(item);
+    siftUp(this->elements.size() - 1);
 }
 
 template<typename T>
-T MinHeap<T>::minimum()
+T MinHeap<T>::extractMin()
 {
-    return this->elements[0];
+    if(this->elements.empty())
+    {
+        throwHeapException("MinHeap::extractMin(): heap is empty");
+    }
+    T heapMin = std::move(this->elements[0]);
+    this->elements[0] = std::move(this->elements.back());
+    this->elements.pop_back();
+    minHeapify(0);
+    return heapMin;
 }
 
+/*
+    Non-throwing version of extractMin.
+    Returns false (and leaves out untouched) if heap is empty.
+*/
 template<typename T>
-T MinHeap<T>::extractMin()
+bool MinHeap<T>::tryPop(T& out)
 {
-    if(this->elements.size() <= 0)      // heap is empty
+    if(this->elements.empty())
     {
-        throw HeapException{"MaxHeap::extractMin(): heap is empty"};
+        return false;
     }
-    T heapMin = minimum();
-    this->elements[0] = this->elements.back();
+    out = std::move(this->elements[0]);
+    this->elements[0] = std::move(this->elements.back());
     this->elements.pop_back();
     minHeapify(0);
-    return heapMin;
+    return true;
+}
+
+/*
+    Same as extractMin + insert, but with only one sift down.
+    Heap must not be empty.
+*/
+template<typename T>
+void MinHeap<T>::replaceTop(const T& item)
+{
+    this->elements[0] = item;
+    minHeapify(0);
 }
 
 template<typename T>
 void MinHeap<T>::decreaseKey(Index i, T decr)
 {
-    if(decr > this->elements[i])
+    if(!tryDecreaseKey(i, std::move(decr)))
     {
-        throw HeapException{"MinHeap::decreaseKey(): new key is not smaller than previous"};
+        throwHeapException("MinHeap::decreaseKey(): new key is not smaller than previous");
     }
-    this->elements[i] = decr;
-    Index curIndex = i;
-    // moving new key up
-    while(curIndex > 0 && (this->elements[this->parent(curIndex)] > this->elements[curIndex]))
+}
+
+/*
+    Non-throwing version of decreaseKey.
+    Returns false if new key is bigger than previous one.
+*/
+template<typename T>
+bool MinHeap<T>::tryDecreaseKey(Index i, T decr)
+{
+    if(decr > this->elements[i])
     {
-        std::swap(this->elements[curIndex], this->elements[this->parent(curIndex)]);
-        curIndex = this->parent(curIndex);
+        return false;
     }
+    this->elements[i] = std::move(decr);
+    siftUp(i);
+    return true;
 }
 
 template<typename T>
 template<typename Container>
-MinHeap<T> MinHeap<T>::buildMinHeap(Container& container)
+MinHeap<T> MinHeap<T>::buildMinHeap(Container& container, std::pmr::memory_resource* resource)
 {
-    MinHeap<T> newHeap;
+    MinHeap<T> newHeap(resource);
     newHeap.elements.resize(std::distance(container.begin(), container.end()), T());
     std::move(container.begin(), container.end(), newHeap.elements.begin());
     for(int i = floor(newHeap.elements.size() / 2) - 1; i >= 0; --i)
@@ -277,3 +428,319 @@ MinHeap<T> MinHeap<T>::buildMinHeap(Container& container)
 }
 
 //------------------------------------------/MIN HEAP
+
+//------------------------------------------MIN MAX HEAP
+
+/*
+    Double-ended heap(Atkinson's min-max heap) on one array.
+    Elements on even levels(root has level 0) are not bigger than their descendants,
+    elements on odd levels are not smaller than them, so minimum is the root and
+    maximum is one of its children.
+    Every operation is O(log n): sifts go over grandparents/grandchildren,
+    and level parity of element does not change on the way.
+*/
+template<typename T>
+class MinMaxHeap : public Heap<T>
+{
+public:
+    explicit MinMaxHeap(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : Heap<T>(resource) {}
+    using Elements = std::pmr::vector<T>;
+    using Index = size_t;
+    void insert(const T& item);
+    // heap must not be empty
+    const T& minimum() const {return this->elements[0];}
+    const T& maximum() const {return this->elements[maxIndex()];}
+    T extractMin();
+    T extractMax();
+    bool tryPopMin(T& out);
+    bool tryPopMax(T& out);
+    // bounded insert: when heap already has capacity elements, the worst one is evicted,
+    // returns false if item itself is the worst one and was not inserted
+    bool insertEvictingMin(const T& item, size_t capacity);
+    bool insertEvictingMax(const T& item, size_t capacity);
+
+    template<typename Container>
+    static MinMaxHeap buildMinMaxHeap(Container& container, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+private:
+    static bool isMinLevel(Index i);
+    Index maxIndex() const;
+    void removeAt(Index i);
+    void trickleDown(Index i);
+    template<typename Compare> void trickleDown(Index i, Compare before);
+    void bubbleUp(Index i);
+    template<typename Compare> void bubbleUpGrandparents(Index i, Compare before);
+};
+
+template<typename T>
+bool MinMaxHeap<T>::isMinLevel(Index i)
+{
+    int level = 0;
+    for(++i; i > 1; i >>= 1)
+    {
+        ++level;
+    }
+    return level % 2 == 0;
+}
+
+template<typename T>
+typename MinMaxHeap<T>::Index MinMaxHeap<T>::maxIndex() const
+{
+    const Index sz = this->elements.size();
+    if(sz <= 2)
+    {
+        return sz - 1;
+    }
+    return (this->elements[2] > this->elements[1]) ? 2 : 1;
+}
+
+template<typename T>
+void MinMaxHeap<T>::insert(const T& item)
+{
+    this->elements.push_back(item);
+    bubbleUp(this->elements.size() - 1);
+}
+
+/*
+    New element is compared with its parent once to choose its kind of levels,
+    then it goes up over grandparents only.
+*/
+template<typename T>
+void MinMaxHeap<T>::bubbleUp(Index i)
+{
+    if(i == 0)
+    {
+        return;
+    }
+    Index p = this->parent(i);
+    if(isMinLevel(i))
+    {
+        if(this->elements[i] > this->elements[p])
+        {
+            std::swap(this->elements[i], this->elements[p]);
+            bubbleUpGrandparents(p, std::greater<T>());
+        }
+        else
+        {
+            bubbleUpGrandparents(i, std::less<T>());
+        }
+    }
+    else
+    {
+        if(this->elements[i] < this->elements[p])
+        {
+            std::swap(this->elements[i], this->elements[p]);
+            bubbleUpGrandparents(p, std::less<T>());
+        }
+        else
+        {
+            bubbleUpGrandparents(i, std::greater<T>());
+        }
+    }
+}
+
+/*
+    before(a, b) - a must be nearer to root than b on levels of i.
+*/
+template<typename T>
+template<typename Compare>
+void MinMaxHeap<T>::bubbleUpGrandparents(Index i, Compare before)
+{
+    T moving = std::move(this->elements[i]);
+    while(i > 2 && before(moving, this->elements[this->parent(this->parent(i))]))
+    {
+        Index grandparent = this->parent(this->parent(i));
+        this->elements[i] = std::move(this->elements[grandparent]);
+        i = grandparent;
+    }
+    this->elements[i] = std::move(moving);
+}
+
+template<typename T>
+void MinMaxHeap<T>::trickleDown(Index i)
+{
+    if(isMinLevel(i))
+    {
+        trickleDown(i, std::less<T>());
+    }
+    else
+    {
+        trickleDown(i, std::greater<T>());
+    }
+}
+
+/*
+    Element goes down to the best of its children and grandchildren.
+    On the way over grandchild it is also checked against the parent of grandchild,
+    which is on levels of other kind.
+*/
+template<typename T>
+template<typename Compare>
+void MinMaxHeap<T>::trickleDown(Index i, Compare before)
+{
+    const Index sz = this->elements.size();
+    while(this->left(i) < sz)
+    {
+        // best of up to 2 children and 4 grandchildren
+        Index best = this->left(i);
+        for(Index j : {this->right(i), this->left(this->left(i)), this->right(this->left(i)),
+                this->left(this->right(i)), this->right(this->right(i))})
+        {
+            if(j < sz && before(this->elements[j], this->elements[best]))
+            {
+                best = j;
+            }
+        }
+        if(!before(this->elements[best], this->elements[i]))
+        {
+            return;
+        }
+        std::swap(this->elements[best], this->elements[i]);
+        // child - it is on levels of other kind, so nothing below it can be broken
+        if(best <= this->right(i))
+        {
+            return;
+        }
+        Index p = this->parent(best);
+        if(before(this->elements[p], this->elements[best]))
+        {
+            std::swap(this->elements[p], this->elements[best]);
+        }
+        i = best;
+    }
+}
+
+/*
+    Last element takes place of removed one and trickles down.
+*/
+template<typename T>
+void MinMaxHeap<T>::removeAt(Index i)
+{
+    this->elements[i] = std::move(this->elements.back());
+    this->elements.pop_back();
+    if(i < this->elements.size())
+    {
+        trickleDown(i);
+    }
+}
+
+template<typename T>
+T MinMaxHeap<T>::extractMin()
+{
+    if(this->elements.empty())
+    {
+        throwHeapException("MinMaxHeap::extractMin(): heap is empty");
+    }
+    T heapMin = std::move(this->elements[0]);
+    removeAt(0);
+    return heapMin;
+}
+
+template<typename T>
+T MinMaxHeap<T>::extractMax()
+{
+    if(this->elements.empty())
+    {
+        throwHeapException("MinMaxHeap::extractMax(): heap is empty");
+    }
+    Index i = maxIndex();
+    T heapMax = std::move(this->elements[i]);
+    removeAt(i);
+    return heapMax;
+}
+
+/*
+    Non-throwing versions of extractMin/extractMax.
+    Return false (and leave out untouched) if heap is empty.
+*/
+template<typename T>
+bool MinMaxHeap<T>::tryPopMin(T& out)
+{
+    if(this->elements.empty())
+    {
+        return false;
+    }
+    out = std::move(this->elements[0]);
+    removeAt(0);
+    return true;
+}
+
+template<typename T>
+bool MinMaxHeap<T>::tryPopMax(T& out)
+{
+    if(this->elements.empty())
+    {
+        return false;
+    }
+    Index i = maxIndex();
+    out = std::move(this->elements[i]);
+    removeAt(i);
+    return true;
+}
+
+/*
+    Keeps capacity biggest elements(top-K buffer):
+    full heap replaces its minimum with bigger item with only one trickle down.
+*/
+template<typename T>
+bool MinMaxHeap<T>::insertEvictingMin(const T& item, size_t capacity)
+{
+    if(this->elements.size() < capacity)
+    {
+        insert(item);
+        return true;
+    }
+    if(capacity == 0 || !(item > this->elements[0]))
+    {
+        return false;
+    }
+    this->elements[0] = item;
+    trickleDown(0);
+    return true;
+}
+
+/*
+    Keeps capacity smallest elements, mirror of insertEvictingMin.
+*/
+template<typename T>
+bool MinMaxHeap<T>::insertEvictingMax(const T& item, size_t capacity)
+{
+    if(this->elements.size() < capacity)
+    {
+        insert(item);
+        return true;
+    }
+    if(capacity == 0)
+    {
+        return false;
+    }
+    Index i = maxIndex();
+    if(!(item < this->elements[i]))
+    {
+        return false;
+    }
+    this->elements[i] = item;
+    // new item can be smaller than minimum
+    if(i > 0 && this->elements[i] < this->elements[0])
+    {
+        std::swap(this->elements[i], this->elements[0]);
+    }
+    trickleDown(i);
+    return true;
+}
+
+template<typename T>
+template<typename Container>
+MinMaxHeap<T> MinMaxHeap<T>::buildMinMaxHeap(Container& container, std::pmr::memory_resource* resource)
+{
+    MinMaxHeap<T> newHeap(resource);
+    newHeap.elements.resize(std::distance(container.begin(), container.end()), T());
+    std::move(container.begin(), container.end(), newHeap.elements.begin());
+    for(int i = floor(newHeap.elements.size() / 2) - 1; i >= 0; --i)
+    {
+        newHeap.trickleDown(i);
+    }
+    return newHeap;
+}
+
+//------------------------------------------/MIN MAX HEAP
@@ -0,0 +1,382 @@
+#pragma once
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "heap.hpp"
+
+/*
+    Reusable engines for merging many sorted streams and for top-k selection.
+        LoserTree - tournament tree for k inputs, replacing winner costs one
+            leaf-to-root pass with log(k) comparisons (pop + push on binary heap
+            costs about twice as much);
+        KWayMerger - streaming merge of k input iterator ranges;
+        kWayMerge - merges ranges to output iterator;
+        parallelKWayMerge - splits merge by splitter keys and merges parts in threads;
+        smallestK/largestK - top-k selection on MaxHeap/MinHeap with replaceTop.
+*/
+
+//------------------------------------------LOSER TREE
+
+/*
+    Leaves are stored in keys, node n (1 <= n < k) keeps index of leaf which lost
+        the game in this node, node 0 keeps overall winner.
+    Leaf i has position i + k, so parent of any position p is p / 2.
+    Equal keys are won by input with smaller index, so merge is stable.
+*/
+template<typename T, typename Compare = std::less<T>>
+class LoserTree
+{
+public:
+    typedef size_t Index;
+    explicit LoserTree(Index k, Compare _comp = Compare());
+    void setLeaf(Index i, const T& key);
+    void build();
+    bool empty() const {return !active[tree[0]];}
+    Index winner() const {return tree[0];}
+    const T& top() const {return keys[tree[0]];}
+    void replaceTop(const T& key);
+    void exhaustTop();
+    Index size() const {return keys.size();}
+private:
+    bool beats(Index a, Index b) const;
+    void replay(Index leaf);
+    std::vector<T> keys;
+    std::vector<char> active;
+    std::vector<Index> tree;
+    Compare comp;
+};
+
+template<typename T, typename Compare>
+LoserTree<T, Compare>::LoserTree(Index k, Compare _comp)
+    : keys(std::max<Index>(k, 1)), active(std::max<Index>(k, 1), 0), tree(std::max<Index>(k, 1), 0), comp{_comp}
+{
+}
+
+template<typename T, typename Compare>
+void LoserTree<T, Compare>::setLeaf(Index i, const T& key)
+{
+    keys[i] = key;
+    active[i] = 1;
+}
+
+template<typename T, typename Compare>
+bool LoserTree<T, Compare>::beats(Index a, Index b) const
+{
+    if(!active[a] || !active[b])
+    {
+        return active[a] || (!active[b] && a < b);
+    }
+    if(comp(keys[a], keys[b]))
+    {
+        return true;
+    }
+    return !comp(keys[b], keys[a]) && a < b;
+}
+
+/*
+    Playing all games bottom-up.
+    Must be called after all leaves were set.
+*/
+template<typename T, typename Compare>
+void LoserTree<T, Compare>::build()
+{
+    const Index k = keys.size();
+    // winners of every node, positions k...2k-1 are leaves
+    std::vector<Index> winners(2 * k);
+    for(Index i = 0; i < k; ++i)
+    {
+        winners[i + k] = i;
+    }
+    for(Index n = k - 1; n >= 1; --n)
+    {
+        Index l = winners[2 * n];
+        Index r = winners[2 * n + 1];
+        bool leftWins = beats(l, r);
+        winners[n] = leftWins ? l : r;
+        tree[n] = leftWins ? r : l;
+    }
+    tree[0] = (k == 1) ? 0 : winners[1];
+}
+
+template<typename T, typename Compare>
+void LoserTree<T, Compare>::replay(Index leaf)
+{
+    Index winnerLeaf = leaf;
+    for(Index n = (leaf + keys.size()) / 2; n >= 1; n /= 2)
+    {
+        if(beats(tree[n], winnerLeaf))
+        {
+            std::swap(tree[n], winnerLeaf);
+        }
+    }
+    tree[0] = winnerLeaf;
+}
+
+// next key of winner's input
+template<typename T, typename Compare>
+void LoserTree<T, Compare>::replaceTop(const T& key)
+{
+    Index leaf = tree[0];
+    keys[leaf] = key;
+    replay(leaf);
+}
+
+// winner's input has ended
+template<typename T, typename Compare>
+void LoserTree<T, Compare>::exhaustTop()
+{
+    Index leaf = tree[0];
+    active[leaf] = 0;
+    replay(leaf);
+}
+
+//------------------------------------------/LOSER TREE
+
+//------------------------------------------K-WAY MERGE
+
+/*
+    Streaming k-way merge.
+    Inputs may be single pass(input iterators): every item is dereferenced once.
+*/
+template<typename InputIt, typename Compare = std::less<typename std::iterator_traits<InputIt>::value_type>>
+class KWayMerger
+{
+public:
+    typedef typename std::iterator_traits<InputIt>::value_type T;
+    typedef std::pair<InputIt, InputIt> Range;
+    KWayMerger(const std::vector<Range>& _ranges, Compare comp = Compare());
+    bool next(T& out);
+private:
+    std::vector<Range> ranges;
+    LoserTree<T, Compare> tree;
+};
+
+template<typename InputIt, typename Compare>
+KWayMerger<InputIt, Compare>::KWayMerger(const std::vector<Range>& _ranges, Compare comp)
+    : ranges{_ranges}, tree(_ranges.size(), comp)
+{
+    for(size_t i = 0; i < ranges.size(); ++i)
+    {
+        if(ranges[i].first != ranges[i].second)
+        {
+            tree.setLeaf(i, *ranges[i].first);
+            ++ranges[i].first;
+        }
+    }
+    tree.build();
+}
+
+template<typename InputIt, typename Compare>
+bool KWayMerger<InputIt, Compare>::next(T& out)
+{
+    if(ranges.empty() || tree.empty())
+    {
+        return false;
+    }
+    out = tree.top();
+    Range& range = ranges[tree.winner()];
+    if(range.first != range.second)
+    {
+        tree.replaceTop(*range.first);
+        ++range.first;
+    }
+    else
+    {
+        tree.exhaustTop();
+    }
+    return true;
+}
+
+template<typename InputIt, typename OutputIt,
+    typename Compare = std::less<typename std::iterator_traits<InputIt>::value_type>>
+OutputIt kWayMerge(const std::vector<std::pair<InputIt, InputIt>>& ranges, OutputIt out, Compare comp = Compare())
+{
+    KWayMerger<InputIt, Compare> merger(ranges, comp);
+    typename KWayMerger<InputIt, Compare>::T item;
+    while(merger.next(item))
+    {
+        *out++ = item;
+    }
+    return out;
+}
+
+/*
+    Parallel merge of sorted random access ranges to random access output.
+    1. samples every range and chooses (parts - 1) splitter keys;
+    2. cuts every range with lower_bound of splitters, so equal keys never
+        fall to different parts and result is the same as sequential merge;
+    3. merges every part in own thread to its own place in output.
+    Exception of comp or output in any thread is rethrown here after all threads
+    have finished(the first one by part order).
+*/
+template<typename RandomIt, typename OutputIt,
+    typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+OutputIt parallelKWayMerge(const std::vector<std::pair<RandomIt, RandomIt>>& ranges, OutputIt out,
+    size_t threads = std::thread::hardware_concurrency(), Compare comp = Compare())
+{
+    typedef typename std::iterator_traits<RandomIt>::value_type T;
+    typedef std::pair<RandomIt, RandomIt> Range;
+    size_t total = 0;
+    for(const Range& range : ranges)
+    {
+        total += std::distance(range.first, range.second);
+    }
+    size_t parts = std::max<size_t>(1, std::min(threads, total / 1024));
+    if(parts == 1)
+    {
+        return kWayMerge(ranges, out, comp);
+    }
+    // 1. splitters
+    std::vector<T> samples;
+    for(const Range& range : ranges)
+    {
+        size_t len = std::distance(range.first, range.second);
+        for(size_t s = 1; s <= parts && len > 0; ++s)
+        {
+            samples.push_back(*(range.first + (len * s) / (parts + 1)));
+        }
+    }
+    std::sort(samples.begin(), samples.end(), comp);
+    std::vector<T> splitters;
+    for(size_t p = 1; p < parts; ++p)
+    {
+        splitters.push_back(samples[(samples.size() * p) / parts]);
+    }
+    // 2. cuts: bounds[p][i] - start of part p in range i
+    std::vector<std::vector<RandomIt>> bounds(parts + 1);
+    for(const Range& range : ranges)
+    {
+        bounds[0].push_back(range.first);
+        for(size_t p = 1; p < parts; ++p)
+        {
+            bounds[p].push_back(std::lower_bound(range.first, range.second, splitters[p - 1], comp));
+        }
+        bounds[parts].push_back(range.second);
+    }
+    // 3. merging
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> failures(parts);
+    OutputIt partOut = out;
+    try
+    {
+        for(size_t p = 0; p < parts; ++p)
+        {
+            std::vector<Range> partRanges;
+            size_t partSize = 0;
+            for(size_t i = 0; i < ranges.size(); ++i)
+            {
+                partRanges.push_back(Range(bounds[p][i], bounds[p + 1][i]));
+                partSize += std::distance(bounds[p][i], bounds[p + 1][i]);
+            }
+            std::exception_ptr& failure = failures[p];
+            workers.emplace_back([partRanges, partOut, comp, &failure]()
+            {
+                try
+                {
+                    kWayMerge(partRanges, partOut, comp);
+                }
+                catch(...)
+                {
+                    failure = std::current_exception();
+                }
+            });
+            partOut += partSize;
+        }
+    }
+    catch(...)
+    {
+        // thread could not be started - started ones must be joined before leaving
+        for(std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        throw;
+    }
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    for(const std::exception_ptr& failure : failures)
+    {
+        if(failure)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+    return partOut;
+}
+
+//------------------------------------------/K-WAY MERGE
+
+//------------------------------------------TOP K
+
+/*
+    k smallest items of range in increasing order.
+    MaxHeap keeps current k smallest, every better item replaces its top with one sift.
+*/
+template<typename InputIt>
+std::vector<typename std::iterator_traits<InputIt>::value_type> smallestK(InputIt first, InputIt last, size_t k)
+{
+    typedef typename std::iterator_traits<InputIt>::value_type T;
+    std::vector<T> result;
+    if(k == 0)
+    {
+        return result;
+    }
+    MaxHeap<T> heap;
+    for(; first != last; ++first)
+    {
+        if(heap.size() < k)
+        {
+            heap.insert(*first);
+        }
+        else if(*first < heap.top())
+        {
+            heap.replaceTop(*first);
+        }
+    }
+    result.resize(heap.size());
+    for(size_t i = result.size(); i > 0; --i)
+    {
+        heap.tryPop(result[i - 1]);
+    }
+    return result;
+}
+
+/*
+    k largest items of range in decreasing order, mirror of smallestK.
+*/
+template<typename InputIt>
+std::vector<typename std::iterator_traits<InputIt>::value_type> largestK(InputIt first, InputIt last, size_t k)
+{
+    typedef typename std::iterator_traits<InputIt>::value_type T;
+    std::vector<T> result;
+    if(k == 0)
+    {
+        return result;
+    }
+    MinHeap<T> heap;
+    for(; first != last; ++first)
+    {
+        if(heap.size() < k)
+        {
+            heap.insert(*first);
+        }
+        else if(*first > heap.top())
+        {
+            heap.replaceTop(*first);
+        }
+    }
+    result.resize(heap.size());
+    for(size_t i = result.size(); i > 0; --i)
+    {
+        heap.tryPop(result[i - 1]);
+    }
+    return result;
+}
+
+//------------------------------------------/TOP K
@@ -0,0 +1,299 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#include "heap.hpp"
+
+/*
+    Heap with priority keys separated from payloads(structure of arrays).
+    Heap array keeps only (key, slot) pairs, payloads stay in slot array and are
+        never moved by sifts, so with big payloads every level of sift touches
+        and moves only few bytes.
+    Handle of item is its slot with generation of this slot: it is stable while item
+        is in heap and can be used to read item, change its key or erase it in O(log n)
+        (position of every slot in heap array is kept).
+    Slots of removed items are reused, payload of removed item is destroyed at once
+        (replaced with Payload(), so Payload must be default constructible).
+    Generation of slot grows on every removal, so handle of removed item never
+        refers to newer item in the same slot: contains() is false for it.
+    Item with comp(key, other) goes nearer to top, so default heap is min heap.
+*/
+
+template<typename Key>
+struct KeyedHeapEntry
+{
+    Key key;
+    std::uint32_t slot;
+};
+
+template<typename Key, typename Payload, typename Compare = std::less<Key>>
+class KeyedHeap : public Heap<KeyedHeapEntry<Key>>
+{
+public:
+    using Entry = KeyedHeapEntry<Key>;
+    using Index = size_t;
+    // generation in high 32 bits, slot in low 32 bits
+    typedef std::uint64_t Handle;
+    static constexpr Handle InvalidHandle = ~Handle(0);
+
+    explicit KeyedHeap(Compare _comp = Compare(), std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : Heap<KeyedHeapEntry<Key>>(resource), payloads(resource), positions(resource), freeSlots(resource),
+          generations(resource), comp{_comp} {}
+    Handle push(const Key& key, Payload payload);
+    // heap must not be empty
+    const Key& topKey() const {return this->elements[0].key;}
+    Payload& topPayload() {return payloads[this->elements[0].slot];}
+    Handle topHandle() const {return handleOf(this->elements[0].slot);}
+    Payload extractTop();
+    bool tryPop(Key& key, Payload& payload);
+
+    //----access by handle
+    bool contains(Handle handle) const;
+    const Key& key(Handle handle) const {return this->elements[positions[slotOf(handle)]].key;}
+    Payload& payload(Handle handle) {return payloads[slotOf(handle)];}
+    void updateKey(Handle handle, const Key& newKey);
+    void erase(Handle handle);
+    //----/access by handle
+    // heap array together with slot arrays
+    HeapMemoryUsage memoryUsage() const;
+    void shrinkToFit();
+private:
+    static constexpr std::uint32_t NotInHeap = ~std::uint32_t(0);
+    static std::uint32_t slotOf(Handle handle) {return std::uint32_t(handle);}
+    Handle handleOf(std::uint32_t slot) const {return (Handle(generations[slot]) << 32) | slot;}
+    std::uint32_t allocateSlot(Payload&& payload);
+    void removeAt(Index i);
+    void place(Index i, Entry&& entry);
+    void siftUp(Index i);
+    void siftDown(Index i);
+    std::pmr::vector<Payload> payloads;
+    // position of slot in heap array, NotInHeap for free slots
+    std::pmr::vector<std::uint32_t> positions;
+    std::pmr::vector<std::uint32_t> freeSlots;
+    // grows on every removal from slot, never shrinks(see shrinkToFit)
+    std::pmr::vector<std::uint32_t> generations;
+    Compare comp;
+};
+
+template<typename Key, typename Payload, typename Compare>
+typename KeyedHeap<Key, Payload, Compare>::Handle KeyedHeap<Key, Payload, Compare>::push(const Key& key, Payload payload)
+{
+    std::uint32_t slot = allocateSlot(std::move(payload));
+    this->elements.push_back(Entry{key, slot});
+    positions[slot] = this->elements.size() - 1;
+    siftUp(this->elements.size() - 1);
+    return handleOf(slot);
+}
+
+template<typename Key, typename Payload, typename Compare>
+std::uint32_t KeyedHeap<Key, Payload, Compare>::allocateSlot(Payload&& payload)
+{
+    if(freeSlots.empty())
+    {
+        if(payloads.size() >= NotInHeap)
+        {
+            throwHeapException("KeyedHeap::push(): too many items");
+        }
+        payloads.push_back(std::move(payload));
+        positions.push_back(NotInHeap);
+        // slot dropped by shrinkToFit keeps its generation
+        if(generations.size() < payloads.size())
+        {
+            generations.push_back(0);
+        }
+        return payloads.size() - 1;
+    }
+    std::uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    payloads[slot] = std::move(payload);
+    return slot;
+}
+
+template<typename Key, typename Payload, typename Compare>
+Payload KeyedHeap<Key, Payload, Compare>::extractTop()
+{
+    if(this->elements.empty())
+    {
+        throwHeapException("KeyedHeap::extractTop(): heap is empty");
+    }
+    Payload top = std::move(payloads[this->elements[0].slot]);
+    removeAt(0);
+    return top;
+}
+
+/*
+    Non-throwing version of extractTop, also gives key of top.
+    Returns false (and leaves key and payload untouched) if heap is empty.
+*/
+template<typename Key, typename Payload, typename Compare>
+bool KeyedHeap<Key, Payload, Compare>::tryPop(Key& key, Payload& payload)
+{
+    if(this->elements.empty())
+    {
+        return false;
+    }
+    key = this->elements[0].key;
+    payload = std::move(payloads[this->elements[0].slot]);
+    removeAt(0);
+    return true;
+}
+
+template<typename Key, typename Payload, typename Compare>
+bool KeyedHeap<Key, Payload, Compare>::contains(Handle handle) const
+{
+    std::uint32_t slot = slotOf(handle);
+    return slot < positions.size() && positions[slot] != NotInHeap && generations[slot] == (handle >> 32);
+}
+
+/*
+    New key can be on any side of old one: item goes up or down.
+*/
+template<typename Key, typename Payload, typename Compare>
+void KeyedHeap<Key, Payload, Compare>::updateKey(Handle handle, const Key& newKey)
+{
+    if(!contains(handle))
+    {
+        throwHeapException("KeyedHeap::updateKey(): handle is not in heap");
+    }
+    Index i = positions[slotOf(handle)];
+    bool up = comp(newKey, this->elements[i].key);
+    this->elements[i].key = newKey;
+    if(up)
+    {
+        siftUp(i);
+    }
+    else
+    {
+        siftDown(i);
+    }
+}
+
+template<typename Key, typename Payload, typename Compare>
+void KeyedHeap<Key, Payload, Compare>::erase(Handle handle)
+{
+    if(!contains(handle))
+    {
+        throwHeapException("KeyedHeap::erase(): handle is not in heap");
+    }
+    removeAt(positions[slotOf(handle)]);
+}
+
+/*
+    Last entry takes place of removed one and goes up or down from there.
+    Slot of removed entry becomes free: its payload is released and its generation
+        grows, so old handles of it are not valid any more.
+*/
+template<typename Key, typename Payload, typename Compare>
+void KeyedHeap<Key, Payload, Compare>::removeAt(Index i)
+{
+    std::uint32_t slot = this->elements[i].slot;
+    positions[slot] = NotInHeap;
+    payloads[slot] = Payload();
+    ++generations[slot];
+    freeSlots.push_back(slot);
+    Entry last = std::move(this->elements.back());
+    this->elements.pop_back();
+    if(i == this->elements.size())
+    {
+        return;
+    }
+    bool up = i > 0 && comp(last.key, this->elements[this->parent(i)].key);
+    place(i, std::move(last));
+    if(up)
+    {
+        siftUp(i);
+    }
+    else
+    {
+        siftDown(i);
+    }
+}
+
+template<typename Key, typename Payload, typename Compare>
+void KeyedHeap<Key, Payload, Compare>::place(Index i, Entry&& entry)
+{
+    positions[entry.slot] = i;
+    this->elements[i] = std::move(entry);
+}
+
+/*
+    Iterative sifts as in MinHeap, moved entries also update positions of their slots.
+*/
+template<typename Key, typename Payload, typename Compare>
+void KeyedHeap<Key, Payload, Compare>::siftUp(Index i)
+{
+    Entry moving = std::move(this->elements[i]);
+    while(i > 0 && comp(moving.key, this->elements[this->parent(i)].key))
+    {
+        place(i, std::move(this->elements[this->parent(i)]));
+        i = this->parent(i);
+    }
+    place(i, std::move(moving));
+}
+
+template<typename Key, typename Payload, typename Compare>
+void KeyedHeap<Key, Payload, Compare>::siftDown(Index i)
+{
+    const Index sz = this->elements.size();
+    if(this->left(i) >= sz)
+    {
+        return;
+    }
+    Entry moving = std::move(this->elements[i]);
+    Index child;
+    while((child = this->left(i)) < sz)
+    {
+        child += (child + 1 < sz && comp(this->elements[child + 1].key, this->elements[child].key));
+        if(!comp(this->elements[child].key, moving.key))
+        {
+            break;
+        }
+        place(i, std::move(this->elements[child]));
+        i = child;
+    }
+    place(i, std::move(moving));
+}
+
+template<typename Key, typename Payload, typename Compare>
+HeapMemoryUsage KeyedHeap<Key, Payload, Compare>::memoryUsage() const
+{
+    HeapMemoryUsage usage = Heap<KeyedHeapEntry<Key>>::memoryUsage();
+    usage.used += payloads.size() * sizeof(Payload)
+        + (positions.size() + freeSlots.size() + generations.size()) * sizeof(std::uint32_t);
+    usage.slack += (payloads.capacity() - payloads.size()) * sizeof(Payload)
+        + (positions.capacity() - positions.size() + freeSlots.capacity() - freeSlots.size()
+            + generations.capacity() - generations.size()) * sizeof(std::uint32_t);
+    return usage;
+}
+
+/*
+    Free slots at the end of slot array are dropped(their handles are not used by anybody),
+    then all arrays give back their slack.
+    Generations of dropped slots are kept: when slot is created again, handles
+        from before shrinkToFit still do not match it.
+*/
+template<typename Key, typename Payload, typename Compare>
+void KeyedHeap<Key, Payload, Compare>::shrinkToFit()
+{
+    size_t slots = payloads.size();
+    while(slots > 0 && positions[slots - 1] == NotInHeap)
+    {
+        --slots;
+    }
+    if(slots < payloads.size())
+    {
+        payloads.erase(payloads.begin() + slots, payloads.end());
+        positions.resize(slots);
+        freeSlots.erase(std::remove_if(freeSlots.begin(), freeSlots.end(), [slots](std::uint32_t slot)
+        {
+            return slot >= slots;
+        }), freeSlots.end());
+    }
+    this->elements.shrink_to_fit();
+    payloads.shrink_to_fit();
+    positions.shrink_to_fit();
+    freeSlots.shrink_to_fit();
+    generations.shrink_to_fit();
+}
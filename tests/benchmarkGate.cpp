@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BTree.hpp"
+#include "heap.hpp"
+#include "vanEmdeBoasTree.hpp"
+#include "vEBStaticTree.hpp"
+
+/*
+	Micro-benchmarks with regression gate:
+		benchmarkGate <baseline file> [tolerance]
+	Every benchmark is run several times and its best ops/sec is compared with baseline
+		(lines "name opsPerSec" of baseline file, '#' starts comment): it fails if it lost more than
+		tolerance(fraction, 0.5 by default) of baseline speed. Exit code is 1 if any
+		benchmark failed, so ctest(and build which runs it) fails.
+	Results are printed in format of baseline file, so baseline of new machine is just output.
+*/
+
+namespace
+{
+	const size_t N = 1 << 17;
+	const int Runs = 3;
+
+	std::vector<std::uint32_t> randomKeys(size_t n, std::uint32_t range, unsigned seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<std::uint32_t> keys(n);
+		for (std::uint32_t& key : keys)
+		{
+			key = random() % range;
+		}
+		return keys;
+	}
+
+	// result is kept here, so compiler can not drop measured work
+	volatile std::uint64_t sink;
+
+	// best ops/sec of Runs runs, prepare is not measured
+	double measure(size_t ops, const std::function<void()>& prepare, const std::function<std::uint64_t()>& work)
+	{
+		double best = 0;
+		for (int run = 0; run < Runs; ++run)
+		{
+			prepare();
+			auto start = std::chrono::steady_clock::now();
+			sink = work();
+			std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+			best = std::max(best, ops / std::max(seconds.count(), 1e-9));
+		}
+		return best;
+	}
+
+	std::map<std::string, double> runBenchmarks()
+	{
+		std::map<std::string, double> results;
+		const std::vector<std::uint32_t> keys = randomKeys(N, 1u << 30, 1);
+		const std::vector<std::uint32_t> queries = randomKeys(N, 1u << 30, 2);
+
+		std::unique_ptr<BTree<std::uint32_t>> btree;
+		results["btree.insert"] = measure(N, [&] { btree.reset(new BTree<std::uint32_t>(16)); }, [&]
+		{
+			for (std::uint32_t key : keys)
+			{
+				btree->insert(key);
+			}
+			return std::uint64_t(btree->size());
+		});
+		results["btree.search"] = measure(N, [] {}, [&]
+		{
+			std::uint64_t found = 0;
+			for (std::uint32_t key : queries)
+			{
+				found += btree->search(key) != nullptr;
+			}
+			return found;
+		});
+		results["btree.searchBatch"] = measure(N, [] {}, [&]
+		{
+			std::uint64_t found = 0;
+			for (const auto& result : btree->searchBatch(queries))
+			{
+				found += result != nullptr;
+			}
+			return found;
+		});
+
+		MinHeap<std::uint32_t> heap;
+		results["minheap.insertExtract"] = measure(2 * N, [] {}, [&]
+		{
+			for (std::uint32_t key : keys)
+			{
+				heap.insert(key);
+			}
+			std::uint64_t sum = 0;
+			std::uint32_t top;
+			while (heap.tryPop(top))
+			{
+				sum += top;
+			}
+			return sum;
+		});
+
+		std::unique_ptr<vEBTree> veb;
+		results["veb.insert"] = measure(N, [&] { veb.reset(new vEBTree(vEBTree::withUniverseBits(30, vEBTree::Storage::Lazy))); }, [&]
+		{
+			std::uint64_t inserted = 0;
+			for (std::uint32_t key : keys)
+			{
+				inserted += veb->insert(key);
+			}
+			return inserted;
+		});
+		results["veb.successor"] = measure(N, [] {}, [&]
+		{
+			std::uint64_t sum = 0;
+			for (std::uint32_t key : queries)
+			{
+				sum += veb->successor(key);
+			}
+			return sum;
+		});
+
+		// universe fixed at compile time, keys of the same queries cut to 24 bits
+		typedef vEBStaticTree<24> StaticTree;
+		std::unique_ptr<StaticTree> staticTree;
+		results["vebstatic.insert"] = measure(N, [&] { staticTree.reset(new StaticTree()); }, [&]
+		{
+			std::uint64_t inserted = 0;
+			for (std::uint32_t key : keys)
+			{
+				inserted += staticTree->insert(key >> 6);
+			}
+			return inserted;
+		});
+		results["vebstatic.successor"] = measure(N, [] {}, [&]
+		{
+			std::uint64_t sum = 0;
+			for (std::uint32_t key : queries)
+			{
+				sum += staticTree->successor(key >> 6);
+			}
+			return sum;
+		});
+		return results;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: benchmarkGate <baseline file> [tolerance]\n");
+		return 2;
+	}
+	const double tolerance = argc > 2 ? std::atof(argv[2]) : 0.5;
+	std::map<std::string, double> baseline;
+	std::ifstream baselineFile(argv[1]);
+	std::string line;
+	while (std::getline(baselineFile, line))
+	{
+		// text after '#' is comment
+		std::istringstream fields(line.substr(0, line.find('#')));
+		std::string name;
+		double opsPerSec;
+		if (fields >> name >> opsPerSec)
+		{
+			baseline[name] = opsPerSec;
+		}
+	}
+	if (baseline.empty())
+	{
+		std::fprintf(stderr, "benchmarkGate: no baseline in %s\n", argv[1]);
+		return 2;
+	}
+
+	bool failed = false;
+	for (const auto& result : runBenchmarks())
+	{
+		auto expected = baseline.find(result.first);
+		const char* verdict = "no baseline";
+		if (expected != baseline.end())
+		{
+			bool regressed = result.second < expected->second * (1 - tolerance);
+			failed = failed || regressed;
+			verdict = regressed ? "REGRESSED" : "ok";
+		}
+		std::printf("%s %.0f\t# %s\n", result.first.c_str(), result.second, verdict);
+	}
+	return failed ? 1 : 0;
+}
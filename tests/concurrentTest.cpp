@@ -0,0 +1,144 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+#include "vEBConcurrentTree.hpp"
+
+/*
+	Multi-threaded stress test of vEBConcurrentTree.
+	Threads own interleaved keys(thread t - keys t, t + threads, ...), so they change
+		the same words and summary bits all the time. While thread has its key k in set,
+		nobody can hide it: contains(k), successor(k - 1) and predecessor(k + 1) must give k.
+	claimFrom case: one thread inserts and erases 320 all the time, other one inserts 321
+		and takes the first key from 0 - it must get 320 or 321.
+	Memory case: all words come from resource given to tree, and memoryUsage is
+		exactly what is allocated.
+	Race is run for given time, so single core machine also switches threads
+		at many points of it.
+	concurrentTest [seconds]
+*/
+
+namespace
+{
+	typedef vEBConcurrentTree::DataType DataType;
+
+	std::atomic<long> failures{ 0 };
+
+	void check(bool condition, const char* what, DataType key, DataType got)
+	{
+		if (!condition && failures++ < 10)
+		{
+			std::fprintf(stderr, "%s(key %llu) gave %llu\n", what, (unsigned long long)key, (unsigned long long)got);
+		}
+	}
+
+	void ownKeys(vEBConcurrentTree& tree, unsigned thread, unsigned threads, DataType range, long rounds)
+	{
+		for (long round = 0; round < rounds; ++round)
+		{
+			for (DataType k = thread + 1; k < range; k += threads)
+			{
+				check(tree.insert(k), "insert", k, 0);
+				check(tree.contains(k), "contains", k, 0);
+				DataType got = tree.successor(k - 1);
+				check(got == k, "successor", k - 1, got);
+				got = tree.predecessor(k + 1);
+				check(got == k, "predecessor", k + 1, got);
+				check(tree.erase(k), "erase", k, 0);
+			}
+		}
+	}
+
+	void claimRace(double seconds)
+	{
+		vEBConcurrentTree tree(12);
+		std::atomic<bool> done{ false };
+		std::thread churn([&tree, &done]
+		{
+			while (!done.load())
+			{
+				tree.insert(320);
+				tree.erase(320);
+			}
+		});
+		auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+		while (std::chrono::steady_clock::now() < end)
+		{
+			tree.insert(321);
+			DataType got = tree.successor(0);
+			check(got == 320 || got == 321, "successor", 0, got);
+			got = tree.claimFrom(0);
+			check(got == 320 || got == 321, "claimFrom", 0, got);
+			if (got == 320)
+			{
+				check(tree.erase(321), "erase", 321, 0);
+			}
+		}
+		done = true;
+		churn.join();
+	}
+
+	// counts live bytes allocated through it
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		size_t live = 0;
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			live += bytes;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* memory, size_t bytes, size_t alignment) override
+		{
+			live -= bytes;
+			std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	};
+
+	void memory()
+	{
+		CountingResource resource;
+		for (int universeBits : { 1, 6, 7, 13, 20 })
+		{
+			{
+				vEBConcurrentTree tree(universeBits, &resource);
+				tree.insert(1);
+				vEBConcurrentMemoryUsage usage = tree.memoryUsage();
+				check(tree.getResource() == &resource && usage.total() == resource.live, "memoryUsage", universeBits, usage.total());
+				check(usage.levelBytes >= (size_t(1) << universeBits) / 8, "levelBytes", universeBits, usage.levelBytes);
+			}
+			check(resource.live == 0, "memory left after tree", universeBits, resource.live);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const double seconds = argc > 1 ? std::atof(argv[1]) : 2;
+	const unsigned threads = 4;
+	// few keys, so all threads change the same leaf words and summary bits on every level
+	vEBConcurrentTree tree(14);
+	std::vector<std::thread> workers;
+	for (unsigned thread = 0; thread < threads; ++thread)
+	{
+		workers.emplace_back(ownKeys, std::ref(tree), thread, threads, 200, long(seconds * 5000));
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	claimRace(seconds);
+	memory();
+	if (failures != 0)
+	{
+		std::fprintf(stderr, "%ld checks failed\n", failures.load());
+		return 1;
+	}
+	std::printf("ok\n");
+	return 0;
+}
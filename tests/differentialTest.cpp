@@ -0,0 +1,1078 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <queue>
+#include <stdexcept>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "BEpsilonTree.hpp"
+#include "BTree.hpp"
+#include "heap.hpp"
+#include "keyedHeap.hpp"
+#include "kWayMerge.hpp"
+#include "vanEmdeBoasTree.hpp"
+#include "vEBMap.hpp"
+#include "vEBStaticTree.hpp"
+#include "yFastTrie.hpp"
+
+/*
+	Randomized differential test: every structure gets the same operations as its
+		std oracle(BTree and its frozen copy, BEpsilonTree - std::set, vEBTree, vEBStaticTree and yFastTrie - std::set, vEBMap - std::map, MinHeap/MaxHeap - std::priority_queue, MinMaxHeap - std::multiset,
+		KeyedHeap - std::map of live handles and std::set of (key, handle),
+		k-way merges - std::stable_sort, smallestK/largestK - std::sort),
+		and every answer and size is compared with oracle's one.
+	Operations are decoded from bytes, so the same runner is:
+		libFuzzer target(built with DIFFERENTIAL_FUZZER, see tests/CMakeLists.txt);
+		randomized test: differentialTest [iterations] [seed] runs all structures
+			on iterations random byte strings.
+	First failed check prints what was compared and aborts.
+*/
+
+namespace
+{
+	class ByteStream
+	{
+	public:
+		ByteStream(const std::uint8_t* _data, size_t _size) : data{ _data }, size{ _size }, position{ 0 } {}
+		inline bool ended() const { return position >= size; }
+		// zeros after the end, so every byte string is a valid program
+		inline std::uint8_t next() { return position < size ? data[position++] : 0; }
+		std::uint64_t nextBelow(std::uint64_t bound);
+	private:
+		const std::uint8_t* data;
+		size_t size;
+		size_t position;
+	};
+
+	std::uint64_t ByteStream::nextBelow(std::uint64_t bound)
+	{
+		std::uint64_t value = 0;
+		for (std::uint64_t range = 1; range < bound && range != 0; range <<= 8)
+		{
+			value = (value << 8) | next();
+		}
+		return bound == 0 ? value : value % bound;
+	}
+
+	void check(bool condition, const char* structure, const char* what, long long key)
+	{
+		if (!condition)
+		{
+			std::fprintf(stderr, "%s: %s differs from oracle(key %lld)\n", structure, what, key);
+			std::abort();
+		}
+	}
+
+	//----BTree
+	void checkBTreeKeys(const BTree<int>& tree, const std::set<int>& oracle)
+	{
+		check(tree.size() == oracle.size(), "BTree", "size", -1);
+		size_t k = 0;
+		for (int key : oracle)
+		{
+			check(tree.select(k++) == key, "BTree", "select", key);
+		}
+	}
+
+	// lowerBound of every key around sorted keys is the same as std::lower_bound
+	void checkFrozenBTree(const FrozenBTree<int>& frozen, const std::vector<int>& sorted, int lo, int hi)
+	{
+		check(frozen.size() == sorted.size(), "FrozenBTree", "size", -1);
+		for (int key = lo; key <= hi; ++key)
+		{
+			const int* found = frozen.lowerBound(key);
+			auto expected = std::lower_bound(sorted.begin(), sorted.end(), key);
+			check(expected == sorted.end() ? found == nullptr : found != nullptr && *found == *expected, "FrozenBTree", "lowerBound", key);
+			check(frozen.contains(key) == std::binary_search(sorted.begin(), sorted.end(), key), "FrozenBTree", "contains", key);
+		}
+	}
+
+	void runBTree(ByteStream& bytes)
+	{
+		const int range = 64 + bytes.next() * 8;
+		BTree<int> tree(2 + bytes.next() % 7);
+		std::set<int> oracle;
+		while (!bytes.ended())
+		{
+			int key = bytes.nextBelow(range);
+			switch (bytes.next() % 8)
+			{
+			case 0:
+			case 1:
+				// BTree keeps duplicates, oracle is a set
+				if (oracle.insert(key).second)
+				{
+					tree.insert(key);
+				}
+				break;
+			case 2:
+				tree.erase(key);
+				oracle.erase(key);
+				break;
+			case 3:
+				check((tree.search(key) != nullptr) == (oracle.count(key) > 0), "BTree", "search", key);
+				break;
+			case 4:
+				check(tree.rank(key) == size_t(std::distance(oracle.begin(), oracle.lower_bound(key))), "BTree", "rank", key);
+				break;
+			case 5:
+			{
+				int hi = key + bytes.nextBelow(range);
+				check(tree.countRange(key, hi) == size_t(std::distance(oracle.lower_bound(key), oracle.upper_bound(hi))),
+					"BTree", "countRange", key);
+				break;
+			}
+			case 6:
+			{
+				std::vector<int> keys{ key, key + 1, key - 1 };
+				auto results = tree.searchBatch(keys, 1 + bytes.next() % 4);
+				for (size_t i = 0; i < keys.size(); ++i)
+				{
+					check((results[i] != nullptr) == (oracle.count(keys[i]) > 0), "BTree", "searchBatch", keys[i]);
+				}
+				// parts of keys on pool threads, results in order of keys
+				auto asyncResults = tree.searchAsync(keys, 1 + bytes.next() % 4).get();
+				check(asyncResults.size() == keys.size(), "BTree", "searchAsync size", key);
+				for (size_t i = 0; i < keys.size(); ++i)
+				{
+					check((asyncResults[i] != nullptr) == (oracle.count(keys[i]) > 0), "BTree", "searchAsync", keys[i]);
+				}
+				break;
+			}
+			case 7:
+			{
+				// split and join back give the same keys
+				// (sometimes right part is in another resource, which dies before tree is checked)
+				std::pmr::unsynchronized_pool_resource otherResource;
+				BTree<int> right = tree.split(key);
+				check(tree.size() == size_t(std::distance(oracle.begin(), oracle.lower_bound(key))), "BTree", "split", key);
+				if (key % 2)
+				{
+					right = right.clone(&otherResource);
+				}
+				tree = BTree<int>::join(tree, right);
+				check(tree.getResource() == std::pmr::get_default_resource() && right.getResource() == (key % 2 ? &otherResource : tree.getResource()),
+					"BTree", "resource after join", key);
+				right = BTree<int>(2);
+				checkBTreeKeys(tree, oracle);
+				break;
+			}
+			}
+		}
+		checkBTreeKeys(tree, oracle);
+		checkFrozenBTree(tree.freeze(), std::vector<int>(oracle.begin(), oracle.end()), -1, range + 1);
+	}
+
+	// both layouts at complete(2^k - 1) and not complete sizes, keys with duplicates
+	void checkFrozenBTreeLayouts()
+	{
+		for (size_t n : { 0, 1, 2, 3, 4, 7, 8, 15, 16, 17, 31, 32, 63, 64, 255, 256, 1000, 1023, 1024, 1025, 4095, 4096 })
+		{
+			std::vector<int> sorted(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				sorted[i] = int(i - i % 2);
+			}
+			for (auto layout : { FrozenBTree<int>::Layout::Eytzinger, FrozenBTree<int>::Layout::VanEmdeBoas })
+			{
+				FrozenBTree<int> frozen(sorted.begin(), sorted.end(), layout);
+				checkFrozenBTree(frozen, sorted, -2, int(2 * n + 1));
+			}
+		}
+	}
+	/*
+		BEpsilonTree - std::set with different t and buffer capacities:
+			1 sends every message down at once, 0 is the default (2t)^2.
+		contains is checked while messages wait in buffers, and at the end
+			for all keys of range before and after flushAll.
+	*/
+	void runBEpsilonTree(ByteStream& bytes)
+	{
+		const int minDegree = 2 + bytes.next() % 6;
+		const size_t capacities[] = { 0, 1, 2, 3, 7, 64 };
+		const size_t bufferCapacity = capacities[bytes.next() % 6];
+		const int range = bytes.next() % 2 ? 256 : 4096;
+		BEpsilonTree<int> tree(minDegree, bufferCapacity);
+		std::set<int> oracle;
+		auto checkAll = [&](const char* what)
+		{
+			for (int key = -1; key <= range; ++key)
+			{
+				check(tree.contains(key) == (oracle.count(key) > 0), "BEpsilonTree", what, key);
+			}
+		};
+		while (!bytes.ended())
+		{
+			int key = int(bytes.nextBelow(range));
+			switch (bytes.next() % 8)
+			{
+			case 0:
+			case 1:
+			case 2:
+				tree.insert(key);
+				oracle.insert(key);
+				break;
+			case 3:
+			case 4:
+				tree.erase(key);
+				oracle.erase(key);
+				break;
+			case 5:
+			case 6:
+				check(tree.contains(key) == (oracle.count(key) > 0), "BEpsilonTree", "contains", key);
+				break;
+			case 7:
+				if (key % 4 == 0)
+				{
+					tree.flushAll();
+					check(tree.memoryUsage().bufferBytes == 0, "BEpsilonTree", "buffers after flushAll", key);
+				}
+				else if (key % 4 == 1)
+				{
+					tree.shrinkToFit();
+				}
+				break;
+			}
+		}
+		checkAll("contains before flushAll");
+		tree.flushAll();
+		check(tree.memoryUsage().bufferBytes == 0, "BEpsilonTree", "buffers after flushAll", range);
+		checkAll("contains after flushAll");
+	}
+
+	/*
+		fromUnsorted with any number of threads must build the same tree as fromSorted:
+			every key in node of the same size, leafness and subtree size, at the same index.
+		Sizes are big enough for parallel sort and parallel building of subtrees.
+	*/
+	void checkBTreeBulkBuilding()
+	{
+		std::mt19937 random(3);
+		for (int minDegree : { 2, 3, 16 })
+		{
+			for (size_t n : { 0, 1, 2, 3, 4, 5, 31, 32, 33, 1000, 4096, 5000, 40000 })
+			{
+				std::vector<int> sorted(n);
+				for (size_t i = 0; i < n; ++i)
+				{
+					sorted[i] = int(3 * i);
+				}
+				std::vector<int> shuffled = sorted;
+				std::shuffle(shuffled.begin(), shuffled.end(), random);
+				BTree<int> expected = BTree<int>::fromSorted(minDegree, sorted.begin(), sorted.end());
+				const size_t nodes = expected.memoryUsage().nodes;
+				for (unsigned threads : { 1u, 2u, 3u, 4u, 8u })
+				{
+					BTree<int> tree = BTree<int>::fromUnsorted(minDegree, shuffled, threads);
+					check(tree.size() == n && tree.memoryUsage().nodes == nodes, "BTree", "fromUnsorted nodes", threads);
+					for (size_t i = 0; i < n; ++i)
+					{
+						auto place = tree.search(sorted[i]);
+						auto expectedPlace = expected.search(sorted[i]);
+						check(place && place->second == expectedPlace->second && place->first->size() == expectedPlace->first->size()
+							&& place->first->leaf == expectedPlace->first->leaf && place->first->subtreeKeys == expectedPlace->first->subtreeKeys,
+							"BTree", "fromUnsorted shape", sorted[i]);
+						check(tree.select(i) == sorted[i] && expected.select(i) == sorted[i], "BTree", "select after bulk building", sorted[i]);
+					}
+				}
+			}
+		}
+	}
+	//----/BTree
+
+	//----heaps
+	template<typename Heap, typename Oracle>
+	void runHeap(ByteStream& bytes, const char* structure)
+	{
+		Heap heap;
+		Oracle oracle;
+		while (!bytes.ended())
+		{
+			int key = int(bytes.nextBelow(1000)) - 500;
+			switch (bytes.next() % 4)
+			{
+			case 0:
+			case 1:
+				heap.insert(key);
+				oracle.push(key);
+				break;
+			case 2:
+			{
+				int top;
+				bool popped = heap.tryPop(top);
+				check(popped == !oracle.empty(), structure, "tryPop", key);
+				if (popped)
+				{
+					check(top == oracle.top(), structure, "popped key", top);
+					oracle.pop();
+				}
+				break;
+			}
+			case 3:
+				if (!oracle.empty())
+				{
+					heap.replaceTop(key);
+					oracle.pop();
+					oracle.push(key);
+				}
+				break;
+			}
+			check(heap.size() == oracle.size(), structure, "size", key);
+			if (!oracle.empty())
+			{
+				check(heap.top() == oracle.top(), structure, "top", key);
+			}
+		}
+	}
+
+	/*
+		MinMaxHeap - std::multiset. Keys are from a small range, so there are many ties.
+		Capacity of bounded inserts is around the size of heap: item is inserted freely,
+			evicts the worst element or is rejected.
+		Heap is sometimes rebuilt with buildMinMaxHeap from keys of oracle in rotated order.
+	*/
+	void runMinMaxHeap(ByteStream& bytes)
+	{
+		std::vector<int> initial(bytes.nextBelow(64));
+		for (int& key : initial)
+		{
+			key = int(bytes.nextBelow(100)) - 50;
+		}
+		std::multiset<int> oracle(initial.begin(), initial.end());
+		MinMaxHeap<int> heap = MinMaxHeap<int>::buildMinMaxHeap(initial);
+		while (!bytes.ended())
+		{
+			int key = int(bytes.nextBelow(100)) - 50;
+			switch (bytes.next() % 8)
+			{
+			case 0:
+			case 1:
+				heap.insert(key);
+				oracle.insert(key);
+				break;
+			case 2:
+			{
+				bool wasEmpty = oracle.empty();
+				bool thrown = false;
+				try
+				{
+					int minimum = heap.extractMin();
+					check(!oracle.empty() && minimum == *oracle.begin(), "MinMaxHeap", "extractMin", minimum);
+					oracle.erase(oracle.begin());
+				}
+				catch (const HeapException&)
+				{
+					thrown = true;
+				}
+				check(thrown == wasEmpty, "MinMaxHeap", "extractMin of empty heap", key);
+				break;
+			}
+			case 3:
+			{
+				bool wasEmpty = oracle.empty();
+				bool thrown = false;
+				try
+				{
+					int maximum = heap.extractMax();
+					check(!oracle.empty() && maximum == *oracle.rbegin(), "MinMaxHeap", "extractMax", maximum);
+					oracle.erase(std::prev(oracle.end()));
+				}
+				catch (const HeapException&)
+				{
+					thrown = true;
+				}
+				check(thrown == wasEmpty, "MinMaxHeap", "extractMax of empty heap", key);
+				break;
+			}
+			case 4:
+			{
+				int popped;
+				bool fromMin = key % 2;
+				bool done = fromMin ? heap.tryPopMin(popped) : heap.tryPopMax(popped);
+				check(done == !oracle.empty(), "MinMaxHeap", fromMin ? "tryPopMin" : "tryPopMax", key);
+				if (done)
+				{
+					auto expected = fromMin ? oracle.begin() : std::prev(oracle.end());
+					check(popped == *expected, "MinMaxHeap", fromMin ? "popped minimum" : "popped maximum", popped);
+					oracle.erase(expected);
+				}
+				break;
+			}
+			case 5:
+			{
+				// keeps capacity biggest keys
+				size_t capacity = bytes.nextBelow(oracle.size() + 3);
+				bool inserted = oracle.size() < capacity || (capacity != 0 && key > *oracle.begin());
+				check(heap.insertEvictingMin(key, capacity) == inserted, "MinMaxHeap", "insertEvictingMin", key);
+				if (inserted && oracle.size() >= capacity)
+				{
+					oracle.erase(oracle.begin());
+				}
+				if (inserted)
+				{
+					oracle.insert(key);
+				}
+				break;
+			}
+			case 6:
+			{
+				// keeps capacity smallest keys
+				size_t capacity = bytes.nextBelow(oracle.size() + 3);
+				bool inserted = oracle.size() < capacity || (capacity != 0 && key < *oracle.rbegin());
+				check(heap.insertEvictingMax(key, capacity) == inserted, "MinMaxHeap", "insertEvictingMax", key);
+				if (inserted && oracle.size() >= capacity)
+				{
+					oracle.erase(std::prev(oracle.end()));
+				}
+				if (inserted)
+				{
+					oracle.insert(key);
+				}
+				break;
+			}
+			case 7:
+			{
+				std::vector<int> keys(oracle.begin(), oracle.end());
+				std::rotate(keys.begin(), keys.begin() + (keys.empty() ? 0 : bytes.nextBelow(keys.size())), keys.end());
+				heap = MinMaxHeap<int>::buildMinMaxHeap(keys);
+				break;
+			}
+			}
+			check(heap.size() == oracle.size(), "MinMaxHeap", "size", key);
+			if (!oracle.empty())
+			{
+				check(heap.minimum() == *oracle.begin(), "MinMaxHeap", "minimum", heap.minimum());
+				check(heap.maximum() == *oracle.rbegin(), "MinMaxHeap", "maximum", heap.maximum());
+			}
+		}
+		// both ends in turn until heap is empty
+		for (bool fromMin = true; !oracle.empty(); fromMin = !fromMin)
+		{
+			auto expected = fromMin ? oracle.begin() : std::prev(oracle.end());
+			check((fromMin ? heap.extractMin() : heap.extractMax()) == *expected, "MinMaxHeap", "drained key", *expected);
+			oracle.erase(expected);
+		}
+		check(heap.empty(), "MinMaxHeap", "empty after drain", 0);
+	}
+
+	/*
+		Payload is shared with oracle, so use_count shows if heap still keeps
+			payload of removed item. Removed handles stay in stale and must never
+			be contained again, even when their slots are reused.
+	*/
+	void runKeyedHeap(ByteStream& bytes)
+	{
+		typedef KeyedHeap<int, std::shared_ptr<int>> Keyed;
+		Keyed heap;
+		std::map<Keyed::Handle, std::pair<int, std::shared_ptr<int>>> live;
+		std::set<std::pair<int, Keyed::Handle>> order;
+		std::vector<Keyed::Handle> stale;
+		auto removed = [&](Keyed::Handle handle)
+		{
+			check(live[handle].second.use_count() == 1, "KeyedHeap", "payload of removed item", live[handle].first);
+			order.erase({ live[handle].first, handle });
+			live.erase(handle);
+			stale.push_back(handle);
+		};
+		while (!bytes.ended())
+		{
+			int key = int(bytes.nextBelow(1000)) - 500;
+			size_t pick = bytes.next();
+			switch (bytes.next() % 5)
+			{
+			case 0:
+			case 1:
+			{
+				auto payload = std::make_shared<int>(key);
+				Keyed::Handle handle = heap.push(key, payload);
+				check(live.count(handle) == 0, "KeyedHeap", "handle of pushed item", key);
+				live[handle] = { key, payload };
+				order.insert({ key, handle });
+				break;
+			}
+			case 2:
+				if (!live.empty())
+				{
+					Keyed::Handle handle = heap.topHandle();
+					check(heap.extractTop() == live[handle].second, "KeyedHeap", "extractTop", key);
+					removed(handle);
+				}
+				break;
+			case 3:
+				if (!live.empty())
+				{
+					auto item = std::next(live.begin(), pick % live.size());
+					order.erase({ item->second.first, item->first });
+					order.insert({ key, item->first });
+					item->second.first = key;
+					heap.updateKey(item->first, key);
+				}
+				break;
+			case 4:
+				if (!live.empty())
+				{
+					Keyed::Handle handle = std::next(live.begin(), pick % live.size())->first;
+					heap.erase(handle);
+					removed(handle);
+				}
+				break;
+			}
+			check(heap.size() == live.size(), "KeyedHeap", "size", key);
+			if (!live.empty())
+			{
+				check(heap.topKey() == order.begin()->first, "KeyedHeap", "top", key);
+			}
+			if (!stale.empty())
+			{
+				check(!heap.contains(stale[pick % stale.size()]), "KeyedHeap", "stale handle", key);
+			}
+			if (pick == 0)
+			{
+				heap.shrinkToFit();
+			}
+		}
+	}
+
+	// item of merged range: equal keys must keep order of ranges, then order in range
+	struct MergeItem
+	{
+		int key;
+		int range;
+		int position;
+		bool operator==(const MergeItem& other) const { return key == other.key && range == other.range && position == other.position; }
+	};
+
+	bool keyLess(const MergeItem& a, const MergeItem& b)
+	{
+		return a.key < b.key;
+	}
+
+	bool keyGreater(const MergeItem& a, const MergeItem& b)
+	{
+		return a.key > b.key;
+	}
+
+	// copying of poisoned item throws, so merge fails while it writes output
+	struct PoisonItem
+	{
+		int key;
+		PoisonItem(int _key = 0) : key{ _key } {}
+		PoisonItem(const PoisonItem& other) = default;
+		PoisonItem(PoisonItem&& other) = default;
+		PoisonItem& operator=(PoisonItem&& other) = default;
+		PoisonItem& operator=(const PoisonItem& other)
+		{
+			if (other.key == Poison)
+			{
+				throw std::runtime_error("poisoned item");
+			}
+			key = other.key;
+			return *this;
+		}
+		bool operator<(const PoisonItem& other) const { return key < other.key; }
+		static const int Poison = -1;
+	};
+
+	/*
+		LoserTree(through kWayMerge), kWayMerge and parallelKWayMerge against std::stable_sort of
+			concatenated ranges: k is not power of two, some ranges are empty, keys have many ties,
+			and totals are big enough for parallel parts(more than 1024 items per thread).
+		Exception of output in a worker must reach the caller.
+		smallestK/largestK against sorted items.
+	*/
+	void checkKWayMerge()
+	{
+		std::mt19937 random(7);
+		for (size_t k : { 1, 2, 3, 5, 7, 12, 33 })
+		{
+			for (size_t total : { 0, 10, 1500, 5000, 20000 })
+			{
+				for (bool descending : { false, true })
+				{
+					auto comp = descending ? keyGreater : keyLess;
+					std::vector<std::vector<MergeItem>> inputs(k);
+					for (size_t i = 0; i < total; ++i)
+					{
+						// every third range is empty
+						size_t range = random() % k;
+						range = (range % 3 == 2 && k > 2) ? 0 : range;
+						inputs[range].push_back(MergeItem{ int(random() % 50), int(range), int(inputs[range].size()) });
+					}
+					std::vector<MergeItem> expected;
+					std::vector<std::pair<std::vector<MergeItem>::const_iterator, std::vector<MergeItem>::const_iterator>> ranges;
+					for (std::vector<MergeItem>& input : inputs)
+					{
+						std::stable_sort(input.begin(), input.end(), comp);
+						expected.insert(expected.end(), input.begin(), input.end());
+						ranges.emplace_back(input.cbegin(), input.cend());
+					}
+					std::stable_sort(expected.begin(), expected.end(), comp);
+					std::vector<MergeItem> merged;
+					kWayMerge(ranges, std::back_inserter(merged), comp);
+					check(merged == expected, "kWayMerge", "merged items", k * 100000 + total);
+					for (size_t threads : { 1, 2, 3, 4, 7 })
+					{
+						std::vector<MergeItem> parallel(total);
+						auto end = parallelKWayMerge(ranges, parallel.begin(), threads, comp);
+						check(end == parallel.end() && parallel == expected, "parallelKWayMerge", "merged items", k * 100 + threads);
+					}
+				}
+			}
+		}
+
+		// poisoned item in one part of parallel merge
+		std::vector<std::vector<PoisonItem>> inputs(5);
+		for (int i = 0; i < 10000; ++i)
+		{
+			inputs[i % 5].push_back(PoisonItem(i));
+		}
+		inputs[3][1500].key = PoisonItem::Poison;
+		std::sort(inputs[3].begin(), inputs[3].end());
+		std::vector<std::pair<std::vector<PoisonItem>::const_iterator, std::vector<PoisonItem>::const_iterator>> ranges;
+		for (const std::vector<PoisonItem>& input : inputs)
+		{
+			ranges.emplace_back(input.cbegin(), input.cend());
+		}
+		bool thrown = false;
+		try
+		{
+			std::vector<PoisonItem> merged(10000);
+			parallelKWayMerge(ranges, merged.begin(), 4);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		check(thrown, "parallelKWayMerge", "exception of worker", PoisonItem::Poison);
+
+		for (size_t n : { 0, 1, 100, 3000 })
+		{
+			std::vector<int> items(n);
+			for (int& item : items)
+			{
+				item = int(random() % 40);
+			}
+			std::vector<int> sorted = items;
+			std::sort(sorted.begin(), sorted.end());
+			for (size_t k : { 0, 1, 3, 10, 999, 5000 })
+			{
+				size_t taken = std::min(k, n);
+				check(smallestK(items.begin(), items.end(), k) == std::vector<int>(sorted.begin(), sorted.begin() + taken),
+					"smallestK", "items", k);
+				check(largestK(items.begin(), items.end(), k) == std::vector<int>(sorted.rbegin(), sorted.rbegin() + taken),
+					"largestK", "items", k);
+			}
+		}
+	}
+	//----/heaps
+
+	//----vEBTree
+	void runvEBTree(ByteStream& bytes)
+	{
+		const int universeBits = 1 + bytes.next() % 24;
+		const vEBTree::DataType u = vEBTree::DataType(1) << universeBits;
+		vEBTree tree(u, universeBits <= 16 && bytes.next() % 2 ? vEBTree::Storage::Eager : vEBTree::Storage::Lazy);
+		std::set<vEBTree::DataType> oracle;
+		while (!bytes.ended())
+		{
+			vEBTree::DataType key = bytes.nextBelow(u);
+			switch (bytes.next() % 8)
+			{
+			case 0:
+			case 1:
+				check(tree.insert(key) == oracle.insert(key).second, "vEBTree", "insert", key);
+				break;
+			case 2:
+				check(tree.erase(key) == (oracle.erase(key) > 0), "vEBTree", "erase", key);
+				break;
+			case 3:
+				check(tree.contains(key) == (oracle.count(key) > 0), "vEBTree", "contains", key);
+				break;
+			case 4:
+			{
+				auto next = oracle.upper_bound(key);
+				check(tree.successor(key) == (next == oracle.end() ? vEBTree::InvalidValue : *next), "vEBTree", "successor", key);
+				auto previous = oracle.lower_bound(key);
+				check(tree.predecessor(key) == (previous == oracle.begin() ? vEBTree::InvalidValue : *std::prev(previous)),
+					"vEBTree", "predecessor", key);
+				break;
+			}
+			case 5:
+			{
+				vEBTree::DataType hi = std::min(u - 1, key + bytes.nextBelow(u));
+				check(tree.countInRange(key, hi) == size_t(std::distance(oracle.lower_bound(key), oracle.upper_bound(hi))),
+					"vEBTree", "countInRange", key);
+				break;
+			}
+			case 6:
+				// the same keys built in one pass
+				if (universeBits <= 16 && key % 2)
+				{
+					std::vector<vEBOperations::Word> bitmap((u + 63) / 64, 0);
+					for (vEBTree::DataType x : oracle)
+					{
+						bitmap[x / 64] |= vEBOperations::Word(1) << (x % 64);
+					}
+					tree = vEBTree::fromBitmap(u, bitmap, tree.getStorage());
+				}
+				else
+				{
+					tree.assignSorted(oracle.begin(), oracle.end());
+				}
+				break;
+			case 7:
+			{
+				// keys out of universe are never in set and change nothing
+				vEBTree::DataType outside = u + key;
+				check(!tree.insert(outside) && !tree.contains(outside) && !tree.erase(outside), "vEBTree", "key out of universe", outside);
+				check(tree.successor(outside) == vEBTree::InvalidValue
+					&& tree.predecessor(outside) == (oracle.empty() ? vEBTree::InvalidValue : *oracle.rbegin()),
+					"vEBTree", "neighbours of key out of universe", outside);
+				break;
+			}
+			}
+			check(tree.empty() == oracle.empty(), "vEBTree", "empty", key);
+			if (!oracle.empty())
+			{
+				check(tree.getMin() == *oracle.begin(), "vEBTree", "min", key);
+				check(tree.getMax() == *oracle.rbegin(), "vEBTree", "max", key);
+			}
+		}
+	}
+
+	/*
+		vEBStaticTree<LogU> - std::set. Half of keys are near one base, so clusters get
+			several keys and summaries change when they are emptied.
+	*/
+	template<unsigned LogU>
+	void runvEBStaticTree(ByteStream& bytes)
+	{
+		typedef vEBStaticTree<LogU> Tree;
+		typedef typename Tree::DataType DataType;
+		const std::uint64_t u = std::uint64_t(1) << LogU;
+		const DataType base = DataType(bytes.nextBelow(u));
+		std::unique_ptr<Tree> tree(new Tree());
+		std::set<DataType> oracle;
+		while (!bytes.ended())
+		{
+			DataType key = DataType(bytes.nextBelow(u));
+			if (bytes.next() % 2)
+			{
+				key = DataType(std::min<std::uint64_t>(u - 1, base + bytes.nextBelow(4096)));
+			}
+			switch (bytes.next() % 6)
+			{
+			case 0:
+			case 1:
+				check(tree->insert(key) == oracle.insert(key).second, "vEBStaticTree", "insert", key);
+				break;
+			case 2:
+			case 3:
+				check(tree->erase(key) == (oracle.erase(key) > 0), "vEBStaticTree", "erase", key);
+				break;
+			case 4:
+				check(tree->contains(key) == (oracle.count(key) > 0), "vEBStaticTree", "contains", key);
+				break;
+			case 5:
+			{
+				auto next = oracle.upper_bound(key);
+				check(tree->successor(key) == (next == oracle.end() ? Tree::InvalidValue : *next), "vEBStaticTree", "successor", key);
+				auto previous = oracle.lower_bound(key);
+				check(tree->predecessor(key) == (previous == oracle.begin() ? Tree::InvalidValue : *std::prev(previous)),
+					"vEBStaticTree", "predecessor", key);
+				break;
+			}
+			}
+			check(tree->getMin() == (oracle.empty() ? Tree::InvalidValue : *oracle.begin())
+				&& tree->getMax() == (oracle.empty() ? Tree::InvalidValue : *oracle.rbegin()), "vEBStaticTree", "min and max", key);
+		}
+		DataType key = tree->getMin();
+		for (DataType expected : oracle)
+		{
+			check(key == expected, "vEBStaticTree", "keys in order", expected);
+			key = tree->successor(key);
+		}
+		check(key == Tree::InvalidValue, "vEBStaticTree", "end of keys", oracle.size());
+	}
+
+	void runvEBStaticTree(ByteStream& bytes)
+	{
+		switch (bytes.next() % 4)
+		{
+		case 0:
+			runvEBStaticTree<7>(bytes);
+			break;
+		case 1:
+			runvEBStaticTree<16>(bytes);
+			break;
+		case 2:
+			runvEBStaticTree<20>(bytes);
+			break;
+		case 3:
+			runvEBStaticTree<24>(bytes);
+			break;
+		}
+	}
+
+	/*
+		vEBMap - std::map, universes of 1-24 and 64 bits.
+		Values are strings, so wrong moves of values inside leaves are seen.
+		Most keys are near one base, so leaves and clusters keep several keys.
+	*/
+	void runvEBMap(ByteStream& bytes)
+	{
+		typedef vEBMap<std::string>::DataType DataType;
+		const int universeBits = bytes.next() % 3 ? 1 + bytes.next() % 24 : 64;
+		const DataType lastKey = universeBits == 64 ? vEBTree::InvalidValue - 1 : (DataType(1) << universeBits) - 1;
+		const DataType base = bytes.nextBelow(lastKey + 1);
+		vEBMap<std::string> map(universeBits);
+		std::map<DataType, std::string> oracle;
+		// checks key and value of neighbour found by map against oracle
+		auto checkNeighbour = [&](std::pair<DataType, std::string*> found, std::map<DataType, std::string>::iterator expected, const char* what, DataType key)
+		{
+			if (expected == oracle.end())
+			{
+				check(found.first == vEBTree::InvalidValue && found.second == nullptr, "vEBMap", what, key);
+			}
+			else
+			{
+				check(found.first == expected->first && found.second && *found.second == expected->second, "vEBMap", what, key);
+			}
+		};
+		long long version = 0;
+		while (!bytes.ended())
+		{
+			DataType key = bytes.nextBelow(lastKey + 1);
+			if (bytes.next() % 4)
+			{
+				DataType offset = bytes.nextBelow(256);
+				key = offset <= lastKey - base ? base + offset : lastKey;
+			}
+			std::string value = std::to_string(key) + "/" + std::to_string(++version);
+			switch (bytes.next() % 7)
+			{
+			case 0:
+			case 1:
+			{
+				// existing key gets new value
+				bool isNew = oracle.find(key) == oracle.end();
+				oracle[key] = value;
+				check(map.insert(key, value) == isNew, "vEBMap", "insert", key);
+				break;
+			}
+			case 2:
+				check(map.erase(key) == (oracle.erase(key) > 0), "vEBMap", "erase", key);
+				break;
+			case 3:
+			{
+				std::string* found = map.find(key);
+				auto expected = oracle.find(key);
+				check(expected == oracle.end() ? found == nullptr : found && *found == expected->second, "vEBMap", "find", key);
+				// value is changed in place
+				if (found)
+				{
+					*found = expected->second = value;
+				}
+				break;
+			}
+			case 4:
+			{
+				checkNeighbour(map.successor(key), oracle.upper_bound(key), "successor", key);
+				auto previous = oracle.lower_bound(key);
+				checkNeighbour(map.predecessor(key), previous == oracle.begin() ? oracle.end() : std::prev(previous), "predecessor", key);
+				break;
+			}
+			case 5:
+			{
+				// keys out of universe are never in map
+				DataType outside = universeBits == 64 ? vEBTree::InvalidValue : lastKey + 1 + key;
+				check(!map.insert(outside, value) && !map.find(outside) && !map.erase(outside), "vEBMap", "key out of universe", outside);
+				checkNeighbour(map.successor(outside), oracle.end(), "successor out of universe", outside);
+				checkNeighbour(map.predecessor(outside), oracle.empty() ? oracle.end() : std::prev(oracle.end()), "predecessor out of universe", outside);
+				break;
+			}
+			case 6:
+				map.shrinkToFit();
+				break;
+			}
+			check(map.size() == oracle.size(), "vEBMap", "size", key);
+			check(map.getMin() == (oracle.empty() ? vEBTree::InvalidValue : oracle.begin()->first)
+				&& map.getMax() == (oracle.empty() ? vEBTree::InvalidValue : oracle.rbegin()->first), "vEBMap", "min and max", key);
+		}
+		// walk through all keys and values with successor
+		std::pair<DataType, std::string*> current = oracle.empty() ? std::make_pair(vEBTree::InvalidValue, (std::string*)nullptr)
+			: std::make_pair(map.getMin(), map.find(map.getMin()));
+		for (auto& item : oracle)
+		{
+			check(current.first == item.first && current.second && *current.second == item.second, "vEBMap", "keys and values in order", item.first);
+			current = map.successor(current.first);
+		}
+		check(current.first == vEBTree::InvalidValue, "vEBMap", "end of keys", oracle.size());
+	}
+
+	/*
+		yFastTrie - std::set, universes up to 64 bits.
+		Most keys are near one base(sometimes the end of universe), and erased keys are
+			taken from oracle, so buckets grow past 2 * universeBits and are split,
+			then shrink and are merged.
+	*/
+	void runyFastTrie(ByteStream& bytes)
+	{
+		typedef yFastTrie::DataType DataType;
+		const int universeBits = bytes.next() % 2 ? 64 : 1 + bytes.next() % 64;
+		const DataType lastKey = universeBits == 64 ? yFastTrie::InvalidValue - 1 : (DataType(1) << universeBits) - 1;
+		const DataType base = bytes.next() % 4 ? bytes.nextBelow(lastKey + 1) : lastKey - std::min<DataType>(lastKey, 256);
+		yFastTrie trie(universeBits);
+		std::set<DataType> oracle;
+		while (!bytes.ended())
+		{
+			DataType key;
+			std::uint8_t source = bytes.next() % 4;
+			if (source == 0)
+			{
+				key = bytes.nextBelow(lastKey + 1);
+			}
+			else if (source == 1 && !oracle.empty())
+			{
+				key = *std::next(oracle.begin(), bytes.nextBelow(oracle.size()));
+			}
+			else
+			{
+				DataType offset = bytes.nextBelow(512);
+				key = offset <= lastKey - base ? base + offset : lastKey;
+			}
+			switch (bytes.next() % 6)
+			{
+			case 0:
+			case 1:
+				check(trie.insert(key) == oracle.insert(key).second, "yFastTrie", "insert", key);
+				break;
+			case 2:
+				check(trie.erase(key) == (oracle.erase(key) > 0), "yFastTrie", "erase", key);
+				break;
+			case 3:
+				check(trie.contains(key) == (oracle.count(key) > 0), "yFastTrie", "contains", key);
+				break;
+			case 4:
+			{
+				auto next = oracle.upper_bound(key);
+				check(trie.successor(key) == (next == oracle.end() ? yFastTrie::InvalidValue : *next), "yFastTrie", "successor", key);
+				auto previous = oracle.lower_bound(key);
+				check(trie.predecessor(key) == (previous == oracle.begin() ? yFastTrie::InvalidValue : *std::prev(previous)),
+					"yFastTrie", "predecessor", key);
+				break;
+			}
+			case 5:
+				check(trie.size() == oracle.size(), "yFastTrie", "size", key);
+				check(trie.getMin() == (oracle.empty() ? yFastTrie::InvalidValue : *oracle.begin())
+					&& trie.getMax() == (oracle.empty() ? yFastTrie::InvalidValue : *oracle.rbegin()), "yFastTrie", "min and max", key);
+				break;
+			}
+		}
+		// walk through all keys with successor
+		DataType key = trie.empty() ? yFastTrie::InvalidValue : trie.getMin();
+		for (DataType expected : oracle)
+		{
+			check(key == expected, "yFastTrie", "keys in order", expected);
+			key = trie.successor(key);
+		}
+		check(key == yFastTrie::InvalidValue, "yFastTrie", "end of keys", oracle.size());
+	}
+
+	//----/vEBTree
+
+	void runAll(const std::uint8_t* data, size_t size)
+	{
+		ByteStream btreeBytes(data, size);
+		runBTree(btreeBytes);
+		ByteStream bEpsilonBytes(data, size);
+		runBEpsilonTree(bEpsilonBytes);
+		ByteStream minHeapBytes(data, size);
+		runHeap<MinHeap<int>, std::priority_queue<int, std::vector<int>, std::greater<int>>>(minHeapBytes, "MinHeap");
+		ByteStream maxHeapBytes(data, size);
+		runHeap<MaxHeap<int>, std::priority_queue<int>>(maxHeapBytes, "MaxHeap");
+		ByteStream minMaxHeapBytes(data, size);
+		runMinMaxHeap(minMaxHeapBytes);
+		ByteStream keyedHeapBytes(data, size);
+		runKeyedHeap(keyedHeapBytes);
+		ByteStream vebBytes(data, size);
+		runvEBTree(vebBytes);
+		ByteStream vebStaticBytes(data, size);
+		runvEBStaticTree(vebStaticBytes);
+		ByteStream vebMapBytes(data, size);
+		runvEBMap(vebMapBytes);
+		ByteStream yFastTrieBytes(data, size);
+		runyFastTrie(yFastTrieBytes);
+	}
+
+	// bulk building must reject keys out of universe and unsorted keys
+	void checkvEBTreeRejects()
+	{
+		bool rejected = false;
+		try
+		{
+			vEBTree::fromBitmap(128, std::vector<vEBOperations::Word>(4, ~vEBOperations::Word(0)));
+		}
+		catch (const vEBTreeCreationException&)
+		{
+			rejected = true;
+		}
+		check(rejected, "vEBTree", "fromBitmap out of universe", 128);
+		std::vector<vEBTree::DataType> outOfUniverse{ 1, 5, 300 };
+		std::vector<vEBTree::DataType> unsorted{ 7, 3 };
+		for (const auto* keys : { &outOfUniverse, &unsorted })
+		{
+			vEBTree tree(256);
+			tree.insert(9);
+			rejected = false;
+			try
+			{
+				tree.assignSorted(keys->begin(), keys->end());
+			}
+			catch (const vEBTreeCreationException&)
+			{
+				rejected = true;
+			}
+			check(rejected && tree.contains(9) && tree.getMin() == 9 && tree.getMax() == 9, "vEBTree", "assignSorted of bad keys", (*keys)[0]);
+		}
+	}
+}
+
+#if defined(DIFFERENTIAL_FUZZER)
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size)
+{
+	runAll(data, size);
+	return 0;
+}
+#else
+int main(int argc, char* argv[])
+{
+	const long iterations = argc > 1 ? std::atol(argv[1]) : 200;
+	std::mt19937_64 random(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1);
+	checkvEBTreeRejects();
+	checkFrozenBTreeLayouts();
+	checkBTreeBulkBuilding();
+	checkKWayMerge();
+	std::vector<std::uint8_t> data;
+	for (long i = 0; i < iterations; ++i)
+	{
+		data.resize(1 + random() % 16384);
+		for (std::uint8_t& byte : data)
+		{
+			byte = std::uint8_t(random());
+		}
+		runAll(data.data(), data.size());
+	}
+	std::printf("%ld random programs passed\n", iterations);
+	return 0;
+}
+#endif
@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include "externalHeap.hpp"
+#if !defined(_WIN32)
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+/*
+	ExternalMinHeap against std::priority_queue, and broken run files:
+		truncated run must throw on read instead of giving wrong items;
+		write over file size limit(POSIX only) must throw on spill.
+	externalHeapTest <directory for run files>
+*/
+
+namespace
+{
+	namespace fs = std::filesystem;
+	typedef std::priority_queue<long, std::vector<long>, std::greater<long>> Oracle;
+
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition && failures++ < 10)
+		{
+			std::fprintf(stderr, "%s\n", what);
+		}
+	}
+
+	void differential(const std::string& dir)
+	{
+		std::mt19937_64 random(2);
+		for (int round = 0; round < 6; ++round)
+		{
+			ExternalMinHeap<long> heap(64, dir, 8);
+			Oracle oracle;
+			for (int op = 0; op < 30000; ++op)
+			{
+				if (random() % 10 < (round % 2 ? 8u : 6u))
+				{
+					long item = random() % 100000;
+					heap.insert(item);
+					oracle.push(item);
+				}
+				else
+				{
+					long top;
+					bool popped = heap.tryPop(top);
+					check(popped == !oracle.empty(), "tryPop result");
+					if (popped)
+					{
+						check(top == oracle.top(), "popped item");
+						oracle.pop();
+					}
+				}
+				check(heap.size() == oracle.size(), "size");
+			}
+			while (!oracle.empty())
+			{
+				check(heap.extractMin() == oracle.top(), "extractMin");
+				oracle.pop();
+			}
+		}
+	}
+
+	// true if heap has thrown HeapException
+	bool throwsWhile(const std::function<void()>& work)
+	{
+		try
+		{
+			work();
+		}
+		catch (const HeapException&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void truncatedRun(const std::string& dir)
+	{
+		// runs are much bigger than buffer of FILE, so cut part is not read yet
+		ExternalMinHeap<long> heap(4096, dir, 64);
+		for (long i = 0; i < 20000; ++i)
+		{
+			heap.insert(20000 - i);
+		}
+		for (const fs::directory_entry& entry : fs::directory_iterator(dir))
+		{
+			fs::resize_file(entry.path(), fs::file_size(entry.path()) / 4);
+		}
+		check(throwsWhile([&heap]
+		{
+			long top;
+			while (heap.tryPop(top))
+			{
+			}
+		}), "truncated run is not found");
+	}
+
+#if !defined(_WIN32)
+	void fileSizeLimit(const std::string& dir)
+	{
+		std::signal(SIGXFSZ, SIG_IGN);
+		rlimit old;
+		getrlimit(RLIMIT_FSIZE, &old);
+		rlimit limit = old;
+		limit.rlim_cur = 100;
+		setrlimit(RLIMIT_FSIZE, &limit);
+		check(throwsWhile([&dir]
+		{
+			ExternalMinHeap<long> heap(16, dir, 4);
+			for (long i = 0; i < 100; ++i)
+			{
+				heap.insert(99 - i);
+			}
+		}), "failed write is not found");
+		setrlimit(RLIMIT_FSIZE, &old);
+	}
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string dir = (fs::path(argc > 1 ? argv[1] : ".") / "externalHeapRuns").string();
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	differential(dir);
+	check(fs::is_empty(dir), "run files are left");
+	truncatedRun(dir);
+#if !defined(_WIN32)
+	fileSizeLimit(dir);
+#endif
+	check(fs::is_empty(dir), "run files are left after errors");
+	fs::remove_all(dir);
+	if (failures != 0)
+	{
+		std::fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	std::printf("ok\n");
+	return 0;
+}
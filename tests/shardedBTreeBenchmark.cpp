@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <random>
+#include <vector>
+#include "ShardedBTree.hpp"
+
+/*
+	ShardedBTree against one BTree with the same keys:
+		ops/sec of insert, contains and batched lookups(containsBatch against searchBatch).
+	Every shard and the single tree get their own pool resource and placement hook
+		does nothing(only counts calls), so on one-node machine it shows the cost
+		of routing and of handing batches to shard workers, not NUMA gains.
+	Answers of both indices are compared, and placement hook must be called once
+		per shard for the whole run - exit code is 1 otherwise.
+	shardedBTreeBenchmark [n] [shards] [batch]
+*/
+
+namespace
+{
+	typedef std::uint32_t Key;
+
+	const int MinDegree = 16;
+
+	volatile size_t sink;
+
+	template<typename Function>
+	double opsPerSec(size_t ops, Function f)
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+		return ops / std::max(seconds.count(), 1e-9);
+	}
+
+	void print(const char* index, const char* operation, double ops)
+	{
+		std::printf("%-12s %-14s %14.0f\n", index, operation, ops);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+	const size_t shardsCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+	const size_t batch = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4096;
+	std::mt19937 random(5);
+	std::vector<Key> keys(n);
+	for (Key& key : keys)
+	{
+		key = random();
+	}
+	// half of queries are keys of index
+	std::vector<Key> queries(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		queries[i] = i % 2 ? keys[random() % n] : Key(random());
+	}
+	std::vector<std::vector<Key>> batches;
+	for (size_t i = 0; i < n; i += batch)
+	{
+		batches.emplace_back(queries.begin() + i, queries.begin() + std::min(n, i + batch));
+	}
+
+	std::printf("n = %zu, shards = %zu, batch = %zu\n", n, shardsCount, batch);
+	std::pmr::synchronized_pool_resource singleResource;
+	BTree<Key> single(MinDegree, &singleResource);
+	print("BTree", "insert", opsPerSec(n, [&]
+	{
+		for (Key key : keys)
+		{
+			single.insert(key);
+		}
+	}));
+	std::vector<char> singleFound(n);
+	print("BTree", "contains", opsPerSec(n, [&]
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			singleFound[i] = single.search(queries[i]) != nullptr;
+		}
+	}));
+	print("BTree", "searchBatch", opsPerSec(n, [&]
+	{
+		size_t found = 0;
+		for (const std::vector<Key>& keysBatch : batches)
+		{
+			for (const auto& result : single.searchBatch(keysBatch))
+			{
+				found += result != nullptr;
+			}
+		}
+		sink = found;
+	}));
+
+	std::vector<std::pmr::synchronized_pool_resource> shardResources(shardsCount);
+	std::vector<std::pmr::memory_resource*> resources;
+	for (std::pmr::synchronized_pool_resource& resource : shardResources)
+	{
+		resources.push_back(&resource);
+	}
+	std::atomic<size_t> placements{ 0 };
+	bool same = true;
+	{
+		ShardedBTree<Key> sharded(MinDegree, resources, 1.5, [&placements](size_t) { ++placements; });
+		print("ShardedBTree", "insert", opsPerSec(n, [&]
+		{
+			for (Key key : keys)
+			{
+				sharded.insert(key);
+			}
+		}));
+		print("ShardedBTree", "contains", opsPerSec(n, [&]
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				same = same && sharded.contains(queries[i]) == bool(singleFound[i]);
+			}
+		}));
+		print("ShardedBTree", "containsBatch", opsPerSec(n, [&]
+		{
+			size_t found = 0;
+			for (const std::vector<Key>& keysBatch : batches)
+			{
+				for (char result : sharded.containsBatch(keysBatch))
+				{
+					found += result;
+				}
+			}
+			sink = found;
+		}));
+		size_t i = 0;
+		for (const std::vector<Key>& keysBatch : batches)
+		{
+			for (char result : sharded.containsBatch(keysBatch))
+			{
+				same = same && bool(result) == bool(singleFound[i++]);
+			}
+		}
+	}
+	if (!same || placements != shardsCount)
+	{
+		std::fprintf(stderr, "%s\n", same ? "placement hook is not called once per shard" : "answers of ShardedBTree and BTree differ");
+		return 1;
+	}
+	return 0;
+}
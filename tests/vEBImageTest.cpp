@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "vanEmdeBoasTree.hpp"
+#include "vEBImage.hpp"
+
+/*
+	vEBImage against vEBTree it was made from, for universes of 1-64 bits
+		(also not multiples of 6, where the highest level word is not full):
+		image of serialize in memory, and file of save opened as vEBMappedImage.
+	contains, successor, predecessor, getMin, getMax and size are compared for keys,
+		their neighbours, ends of universe, keys out of universe and random queries.
+	Broken files(truncated, wrong magic) must throw vEBImageException.
+	vEBImageTest <directory for image files>
+*/
+
+namespace
+{
+	namespace fs = std::filesystem;
+	typedef vEBTree::DataType DataType;
+
+	int failures = 0;
+
+	void check(bool condition, const char* what, int universeBits, DataType key)
+	{
+		if (!condition && failures++ < 10)
+		{
+			std::fprintf(stderr, "%s differs from tree(%d bits, key %llu)\n", what, universeBits, (unsigned long long)key);
+		}
+	}
+
+	void compare(const vEBImage& image, vEBTree& tree, size_t count, const std::vector<DataType>& queries)
+	{
+		const int bits = tree.getUniverseBits();
+		check(image.getUniverseBits() == bits, "universe", bits, 0);
+		check(image.size() == count && image.empty() == (count == 0), "size", bits, count);
+		check(image.getMin() == tree.getMin(), "getMin", bits, tree.getMin());
+		check(image.getMax() == tree.getMax(), "getMax", bits, tree.getMax());
+		for (DataType x : queries)
+		{
+			check(image.contains(x) == tree.contains(x), "contains", bits, x);
+			check(image.successor(x) == tree.successor(x), "successor", bits, x);
+			check(image.predecessor(x) == tree.predecessor(x), "predecessor", bits, x);
+		}
+	}
+
+	// sparse keys, or dense runs of keys(many full leaf words)
+	std::set<DataType> makeKeys(std::mt19937_64& random, DataType lastKey, size_t n, bool dense)
+	{
+		std::set<DataType> keys;
+		DataType start = random() % (lastKey + 1);
+		for (size_t i = 0; i < n; ++i)
+		{
+			DataType key = random() % (lastKey + 1);
+			if (dense)
+			{
+				DataType offset = random() % (4 * n);
+				key = offset <= lastKey - start ? start + offset : lastKey - offset % (lastKey + 1);
+			}
+			keys.insert(key);
+		}
+		return keys;
+	}
+
+	void roundTrip(const std::string& dir, int universeBits, const std::set<DataType>& keys, std::mt19937_64& random)
+	{
+		const DataType lastKey = universeBits == vEBTree::MaxUniverseBits ? vEBTree::InvalidValue - 1 : (DataType(1) << universeBits) - 1;
+		vEBTree tree = vEBTree::withUniverseBits(universeBits, vEBTree::Storage::Lazy);
+		for (DataType key : keys)
+		{
+			tree.insert(key);
+		}
+		std::vector<DataType> queries{ 0, 1, lastKey - 1, lastKey, vEBTree::InvalidValue };
+		if (universeBits < vEBTree::MaxUniverseBits)
+		{
+			queries.push_back(lastKey + 1);
+			queries.push_back(lastKey + 1 + random() % (lastKey + 1));
+		}
+		for (DataType key : keys)
+		{
+			queries.push_back(key);
+			queries.push_back(key - 1);
+			queries.push_back(key + 1);
+		}
+		for (int i = 0; i < 1000; ++i)
+		{
+			queries.push_back(random() % (lastKey + 1));
+		}
+
+		std::vector<vEBImage::Word> words = vEBImage::serialize(tree);
+		compare(vEBImage(words.data(), words.size() * sizeof(vEBImage::Word)), tree, keys.size(), queries);
+
+		const std::string path = (fs::path(dir) / ("image" + std::to_string(universeBits))).string();
+		vEBImage::save(tree, path);
+		check(fs::file_size(path) == words.size() * sizeof(vEBImage::Word), "file size", universeBits, keys.size());
+		{
+			vEBMappedImage mapped(path);
+			compare(mapped.image(), tree, keys.size(), queries);
+		}
+		fs::remove(path);
+	}
+
+	// true if opening of path has thrown vEBImageException
+	bool rejected(const std::string& path)
+	{
+		try
+		{
+			vEBMappedImage mapped(path);
+		}
+		catch (const vEBImageException&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void brokenFiles(const std::string& dir)
+	{
+		vEBTree tree = vEBTree::withUniverseBits(20, vEBTree::Storage::Lazy);
+		for (DataType key = 0; key < 5000; key += 7)
+		{
+			tree.insert(key);
+		}
+		std::vector<vEBImage::Word> words = vEBImage::serialize(tree);
+		const std::string path = (fs::path(dir) / "broken").string();
+		vEBImage::save(tree, path);
+		fs::resize_file(path, (words.size() - 1) * sizeof(vEBImage::Word));
+		check(rejected(path), "truncated file rejection", 20, words.size());
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		words[0] = ~vEBImage::Magic;
+		std::fwrite(words.data(), sizeof(vEBImage::Word), words.size(), file);
+		std::fclose(file);
+		check(rejected(path), "wrong magic rejection", 20, words[0]);
+		check(rejected((fs::path(dir) / "missing").string()), "missing file rejection", 20, 0);
+		fs::remove(path);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string dir = (fs::path(argc > 1 ? argv[1] : ".") / "vEBImageFiles").string();
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	std::mt19937_64 random(4);
+	for (int universeBits : { 1, 5, 6, 7, 11, 12, 13, 20, 31, 32, 37, 47, 48, 63, 64 })
+	{
+		const DataType lastKey = universeBits == vEBTree::MaxUniverseBits ? vEBTree::InvalidValue - 1 : (DataType(1) << universeBits) - 1;
+		// empty, both ends of universe, sparse and dense keys
+		roundTrip(dir, universeBits, {}, random);
+		roundTrip(dir, universeBits, { 0, lastKey }, random);
+		roundTrip(dir, universeBits, makeKeys(random, lastKey, 300, false), random);
+		roundTrip(dir, universeBits, makeKeys(random, lastKey, 3000, true), random);
+	}
+	brokenFiles(dir);
+	fs::remove_all(dir);
+	if (failures != 0)
+	{
+		std::fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	std::printf("ok\n");
+	return 0;
+}
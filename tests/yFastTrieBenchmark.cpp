@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+#include "vanEmdeBoasTree.hpp"
+#include "yFastTrie.hpp"
+
+/*
+	yFastTrie against vEBTree(Lazy storage) and std::set with the same n keys:
+		ops/sec of insert, contains, successor, predecessor and erase,
+		and memory of filled set - all heap bytes allocated by it(global operator new
+		of this program counts live bytes, so all three sets are measured the same way).
+	Answers of all sets are compared, exit code is 1 if they differ.
+	Universes of 32 and 64 bits: for 2^64 only lazy vEBTree and O(n) sets are possible.
+	yFastTrieBenchmark [n]
+*/
+
+namespace
+{
+	size_t liveBytes = 0;
+
+	// allocation keeps its size before itself
+	const size_t Header = 16;
+
+	void* allocate(size_t size, size_t alignment)
+	{
+		size_t header = std::max(Header, alignment);
+		void* block = alignment > Header ? std::aligned_alloc(alignment, (header + size + alignment - 1) / alignment * alignment)
+			: std::malloc(header + size);
+		if (!block)
+		{
+			throw std::bad_alloc();
+		}
+		char* memory = static_cast<char*>(block) + header;
+		reinterpret_cast<size_t*>(memory)[-1] = size;
+		liveBytes += size;
+		return memory;
+	}
+
+	void deallocate(void* memory, size_t alignment)
+	{
+		if (memory)
+		{
+			liveBytes -= static_cast<size_t*>(memory)[-1];
+			std::free(static_cast<char*>(memory) - std::max(Header, alignment));
+		}
+	}
+}
+
+void* operator new(size_t size) { return allocate(size, Header); }
+void* operator new[](size_t size) { return allocate(size, Header); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocate(size, size_t(alignment)); }
+void operator delete(void* memory) noexcept { deallocate(memory, Header); }
+void operator delete[](void* memory) noexcept { deallocate(memory, Header); }
+void operator delete(void* memory, size_t) noexcept { deallocate(memory, Header); }
+void operator delete[](void* memory, size_t) noexcept { deallocate(memory, Header); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { deallocate(memory, size_t(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { deallocate(memory, size_t(alignment)); }
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept { deallocate(memory, size_t(alignment)); }
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept { deallocate(memory, size_t(alignment)); }
+
+namespace
+{
+	typedef vEBTree::DataType DataType;
+
+	// std::set with the same interface as trees
+	class StdSet
+	{
+	public:
+		explicit StdSet(int) {}
+		bool contains(DataType x) const { return keys.count(x) > 0; }
+		DataType successor(DataType x) const
+		{
+			auto next = keys.upper_bound(x);
+			return next == keys.end() ? vEBTree::InvalidValue : *next;
+		}
+		DataType predecessor(DataType x) const
+		{
+			auto next = keys.lower_bound(x);
+			return next == keys.begin() ? vEBTree::InvalidValue : *std::prev(next);
+		}
+		bool insert(DataType x) { return keys.insert(x).second; }
+		bool erase(DataType x) { return keys.erase(x) > 0; }
+	private:
+		std::set<DataType> keys;
+	};
+
+	class LazyvEBTree final : public vEBTree
+	{
+	public:
+		explicit LazyvEBTree(int universeBits) : vEBTree(withUniverseBits(universeBits, Storage::Lazy)) {}
+	};
+
+	volatile DataType sink;
+
+	// sums of answers, the same for every set which is right
+	struct Answers
+	{
+		size_t inserted;
+		DataType found;
+		DataType successors;
+		DataType predecessors;
+		size_t erased;
+		bool operator==(const Answers& other) const
+		{
+			return inserted == other.inserted && found == other.found && successors == other.successors
+				&& predecessors == other.predecessors && erased == other.erased;
+		}
+	};
+
+	template<typename Function>
+	double opsPerSec(size_t ops, Function f)
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+		return ops / std::max(seconds.count(), 1e-9);
+	}
+
+	template<typename Set>
+	Answers run(const char* name, int universeBits, const std::vector<DataType>& keys, const std::vector<DataType>& queries)
+	{
+		Answers answers{};
+		size_t before = liveBytes;
+		auto set = std::make_unique<Set>(universeBits);
+		double insert = opsPerSec(keys.size(), [&]
+		{
+			for (DataType key : keys)
+			{
+				answers.inserted += set->insert(key);
+			}
+		});
+		size_t bytes = liveBytes - before;
+		double contains = opsPerSec(queries.size(), [&]
+		{
+			DataType found = 0;
+			for (DataType key : queries)
+			{
+				found += set->contains(key);
+			}
+			sink = answers.found = found;
+		});
+		double successor = opsPerSec(queries.size(), [&]
+		{
+			DataType sum = 0;
+			for (DataType key : queries)
+			{
+				sum += set->successor(key);
+			}
+			sink = answers.successors = sum;
+		});
+		double predecessor = opsPerSec(queries.size(), [&]
+		{
+			DataType sum = 0;
+			for (DataType key : queries)
+			{
+				sum += set->predecessor(key);
+			}
+			sink = answers.predecessors = sum;
+		});
+		double erase = opsPerSec(keys.size(), [&]
+		{
+			for (DataType key : keys)
+			{
+				answers.erased += set->erase(key);
+			}
+		});
+		set.reset();
+		std::printf("%-10s %4d %12.0f %12.0f %12.0f %12.0f %12.0f %12zu %10.1f\n", name, universeBits,
+			insert, contains, successor, predecessor, erase, bytes, double(bytes) / keys.size());
+		return answers;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 18;
+	std::printf("n = %zu\n%-10s %4s %12s %12s %12s %12s %12s %12s %10s\n", n, "set", "bits",
+		"insert/s", "contains/s", "successor/s", "predec./s", "erase/s", "bytes", "bytes/key");
+	for (int universeBits : { 32, 64 })
+	{
+		std::mt19937_64 random(universeBits);
+		const DataType mask = universeBits == 64 ? ~DataType(0) : (DataType(1) << universeBits) - 1;
+		std::unordered_set<DataType> distinct;
+		std::vector<DataType> keys;
+		while (keys.size() < n)
+		{
+			DataType key = random() & mask;
+			if (key != vEBTree::InvalidValue && distinct.insert(key).second)
+			{
+				keys.push_back(key);
+			}
+		}
+		// half of queries are keys of set
+		std::vector<DataType> queries(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			DataType key = random() & mask;
+			queries[i] = i % 2 ? keys[random() % n] : key == vEBTree::InvalidValue ? key - 1 : key;
+		}
+		Answers trie = run<yFastTrie>("yFastTrie", universeBits, keys, queries);
+		Answers veb = run<LazyvEBTree>("vEBTree", universeBits, keys, queries);
+		Answers oracle = run<StdSet>("std::set", universeBits, keys, queries);
+		if (!(trie == oracle) || !(veb == oracle))
+		{
+			std::fprintf(stderr, "answers of %s and std::set differ for %d bits\n", trie == oracle ? "vEBTree" : "yFastTrie", universeBits);
+			return 1;
+		}
+	}
+	return 0;
+}
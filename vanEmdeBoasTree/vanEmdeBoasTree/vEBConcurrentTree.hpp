@@ -0,0 +1,392 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include "vanEmdeBoasTree.hpp"
+
+/*
+	Bytes taken by vEBConcurrentTree(see vEBConcurrentTree::memoryUsage):
+		levels - number of levels,
+		levelBytes - words of all levels,
+		clearingBytes - clearing words of summary levels,
+		tableBytes - arrays of level pointers and sizes.
+*/
+struct vEBConcurrentMemoryUsage
+{
+	size_t levels;
+	size_t levelBytes;
+	size_t clearingBytes;
+	size_t tableBytes;
+	inline size_t total() const { return levelBytes + clearingBytes + tableBytes; }
+};
+
+/*
+	Concurrent successor set for fixed universe u = 2^universeBits
+		(free-ID/free-slot sets shared by many threads).
+	Layout is the same idea as vEBTree with 64-bit leaves, but with fixed fan-out 64:
+		level 0 - one bit per key,
+		level i + 1 - one bit per word of level i(bit is set when that word is not empty),
+		top level is one word.
+	All words are atomic, so:
+		contains is one load;
+		successor/predecessor only load words and never wait for writers
+			(at most two words per level are read for every level climbed);
+		insert is one fetch_or on leaf word and one load per summary level(fetch_or
+			only when summary bit is not set yet), erase is one fetch_and on leaf word,
+			summary words are changed only when leaf word becomes empty;
+		claimFrom(x) - takes first key >= x out of set, lock-free.
+	Every key is reachable from top as soon as its insert returns:
+		insert checks summary bits on all levels(writer who has made the word non-empty
+			can be still setting them);
+		writer who has emptied a word clears its summary bit and then checks the word
+			again(and sets the bit back if somebody has inserted into it). Between these
+			steps completed insert could be hidden, so the bit is marked in clearing words
+			first, and readers take summary bit as set when it is set or marked.
+			Only one writer clears the bit at a time(others leave it to the marker, which
+			checks the word once more after unmarking and clears the bit again if it is empty).
+	Summary bit can be set for empty word(readers just skip such word): for a short time
+		while it is cleared, and also when insert sets bits of upper levels after its key
+		has been erased and upper words have been cleared - such bits stay until the next
+		change of that word.
+	Memory is about u/8 bytes, so universeBits is limited with MaxUniverseBits.
+	All words are allocated from memory resource given on construction. Their number
+		is fixed by u, so there is no shrinkToFit.
+*/
+class vEBConcurrentTree
+{
+	typedef vEBOperations::Word Word;
+	typedef std::atomic<Word> AtomicWord;
+	// words are freed to memory resource they were allocated from
+	struct LevelDeleter
+	{
+		std::pmr::memory_resource* resource;
+		size_t words;
+		void operator()(AtomicWord* level) const;
+	};
+	typedef std::unique_ptr<AtomicWord[], LevelDeleter> Level;
+public:
+	typedef vEBTree::DataType DataType;
+	static constexpr DataType InvalidValue = vEBTree::InvalidValue;
+	enum { MaxUniverseBits = 40 };
+
+	explicit vEBConcurrentTree(int _universeBits, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	vEBConcurrentTree(const vEBConcurrentTree&) = delete;
+	vEBConcurrentTree& operator=(const vEBConcurrentTree&) = delete;
+
+	inline int getUniverseBits() const { return universeBits; }
+	// does not depend on keys, so it can be called while set is changed
+	vEBConcurrentMemoryUsage memoryUsage() const;
+	inline std::pmr::memory_resource* getResource() const { return resource; }
+
+	//----main methods
+	bool contains(DataType x) const;
+	DataType predecessor(DataType x) const;
+	DataType successor(DataType x) const;
+	bool insert(DataType x);
+	bool erase(DataType x);
+	DataType claimFrom(DataType x);
+	//----/main methods
+
+private:
+	inline bool inUniverse(DataType x) const { return (x >> universeBits) == 0; }
+	DataType firstFrom(DataType x) const;
+	DataType lastUpTo(DataType x) const;
+	// word with bits of clearing summary bits
+	inline Word loadWord(int level, DataType w) const
+	{
+		Word word = levels[level][w].load();
+		return level == 0 ? word : word | clearing[level][w].load();
+	}
+	void markNonEmpty(DataType wordIndex);
+	void markEmpty(int level, DataType wordIndex);
+	Level allocateLevel(size_t words);
+
+	std::pmr::vector<Level> levels;
+	// summary bits which are being cleared(see markEmpty), empty for level 0
+	std::pmr::vector<Level> clearing;
+	std::pmr::vector<DataType> levelWords;
+	int universeBits;
+	std::pmr::memory_resource* resource;
+};
+
+inline vEBConcurrentTree::vEBConcurrentTree(int _universeBits, std::pmr::memory_resource* _resource)
+	: levels(_resource), clearing(_resource), levelWords(_resource), universeBits{ _universeBits }, resource{ _resource }
+{
+	if (universeBits < 1 || universeBits > MaxUniverseBits)
+	{
+		throw vEBTreeCreationException{};
+	}
+	// one bit per key on level 0, one bit per word of previous level on others
+	DataType bitsOnLevel = DataType(1) << universeBits;
+	do
+	{
+		DataType words = (bitsOnLevel + 63) / 64;
+		levels.push_back(allocateLevel(words));
+		clearing.push_back(levels.size() > 1 ? allocateLevel(words) : Level(nullptr, LevelDeleter{ resource, 0 }));
+		levelWords.push_back(words);
+		bitsOnLevel = words;
+	} while (bitsOnLevel > 1);
+}
+
+inline void vEBConcurrentTree::LevelDeleter::operator()(AtomicWord* level) const
+{
+	for (size_t i = 0; i < words; ++i)
+	{
+		level[i].~AtomicWord();
+	}
+	resource->deallocate(level, words * sizeof(AtomicWord), alignof(AtomicWord));
+}
+
+/*
+	Zeroed words in memory of resource of this tree.
+*/
+inline vEBConcurrentTree::Level vEBConcurrentTree::allocateLevel(size_t words)
+{
+	AtomicWord* level = static_cast<AtomicWord*>(resource->allocate(words * sizeof(AtomicWord), alignof(AtomicWord)));
+	for (size_t i = 0; i < words; ++i)
+	{
+		new (&level[i]) AtomicWord(0);
+	}
+	return Level(level, LevelDeleter{ resource, words });
+}
+
+inline vEBConcurrentMemoryUsage vEBConcurrentTree::memoryUsage() const
+{
+	vEBConcurrentMemoryUsage usage{ levels.size(), 0, 0, 0 };
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		usage.levelBytes += levelWords[level] * sizeof(AtomicWord);
+		usage.clearingBytes += (level > 0) ? levelWords[level] * sizeof(AtomicWord) : 0;
+	}
+	usage.tableBytes = levels.capacity() * sizeof(Level) + clearing.capacity() * sizeof(Level) + levelWords.capacity() * sizeof(DataType);
+	return usage;
+}
+
+inline bool vEBConcurrentTree::contains(DataType x) const
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	return (levels[0][x >> 6].load() >> (x & 63)) & 1;
+}
+
+inline vEBConcurrentTree::DataType vEBConcurrentTree::successor(DataType x) const
+{
+	if (!inUniverse(x + 1) || x == InvalidValue)
+	{
+		return InvalidValue;
+	}
+	return firstFrom(x + 1);
+}
+
+inline vEBConcurrentTree::DataType vEBConcurrentTree::predecessor(DataType x) const
+{
+	if (x == 0)
+	{
+		return InvalidValue;
+	}
+	if (!inUniverse(x - 1))
+	{
+		x = (DataType(1) << universeBits);
+	}
+	return lastUpTo(x - 1);
+}
+
+/*
+	Smallest key >= x.
+	Goes up while words have nothing at or after current position,
+		and down along first set bits - if stale summary bit leads to empty word,
+		search simply continues after this word.
+*/
+inline vEBConcurrentTree::DataType vEBConcurrentTree::firstFrom(DataType x) const
+{
+	int level = 0;
+	DataType pos = x;
+	const int topLevel = (int)levels.size() - 1;
+	for (;;)
+	{
+		DataType w = pos >> 6;
+		if (w >= levelWords[level])
+		{
+			return InvalidValue;
+		}
+		Word word = loadWord(level, w) & (~Word(0) << (pos & 63));
+		if (word == 0)
+		{
+			if (level == topLevel)
+			{
+				return InvalidValue;
+			}
+			// nothing here - next word is searched through upper level
+			pos = w + 1;
+			++level;
+			continue;
+		}
+		DataType found = (w << 6) | vEBOperations::lowestBit(word);
+		if (level == 0)
+		{
+			return found;
+		}
+		pos = found << 6;
+		--level;
+	}
+}
+
+/*
+	Largest key <= x, mirror of firstFrom.
+*/
+inline vEBConcurrentTree::DataType vEBConcurrentTree::lastUpTo(DataType x) const
+{
+	int level = 0;
+	DataType pos = x;
+	const int topLevel = (int)levels.size() - 1;
+	for (;;)
+	{
+		DataType w = pos >> 6;
+		Word word = loadWord(level, w) & (~Word(0) >> (63 - (pos & 63)));
+		if (word == 0)
+		{
+			if (level == topLevel || w == 0)
+			{
+				return InvalidValue;
+			}
+			pos = w - 1;
+			++level;
+			continue;
+		}
+		DataType found = (w << 6) | vEBOperations::highestBit(word);
+		if (level == 0)
+		{
+			return found;
+		}
+		pos = (found << 6) | 63;
+		--level;
+	}
+}
+
+/*
+	Returns true if x was not in set.
+*/
+inline bool vEBConcurrentTree::insert(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	Word bit = Word(1) << (x & 63);
+	Word old = levels[0][x >> 6].fetch_or(bit);
+	if (old & bit)
+	{
+		return false;
+	}
+	// even if word was not empty, writer who made it non-empty can be still setting summary bits
+	markNonEmpty(x >> 6);
+	return true;
+}
+
+/*
+	Returns true if x was in set(and only one of concurrent erasers of x gets true).
+*/
+inline bool vEBConcurrentTree::erase(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	Word bit = Word(1) << (x & 63);
+	Word old = levels[0][x >> 6].fetch_and(~bit);
+	if (!(old & bit))
+	{
+		return false;
+	}
+	if ((old & ~bit) == 0)
+	{
+		markEmpty(1, x >> 6);
+	}
+	return true;
+}
+
+/*
+	Takes smallest key >= x out of set and returns it(InvalidValue if there is no such key).
+	If other thread takes found key first, search continues from it, so some thread
+		always makes progress.
+*/
+inline vEBConcurrentTree::DataType vEBConcurrentTree::claimFrom(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return InvalidValue;
+	}
+	for (;;)
+	{
+		DataType candidate = firstFrom(x);
+		if (candidate == InvalidValue || erase(candidate))
+		{
+			return candidate;
+		}
+		x = candidate;
+	}
+}
+
+/*
+	Word wordIndex of level 0 is not empty: its bit is set on every summary level.
+	Bit which is set now is cleared only by markEmpty, which checks the word after it,
+		so only missing bits need fetch_or.
+*/
+inline void vEBConcurrentTree::markNonEmpty(DataType wordIndex)
+{
+	for (int level = 1; level < (int)levels.size(); ++level)
+	{
+		Word bit = Word(1) << (wordIndex & 63);
+		AtomicWord& word = levels[level][wordIndex >> 6];
+		if (!(word.load() & bit))
+		{
+			word.fetch_or(bit);
+		}
+		wordIndex >>= 6;
+	}
+}
+
+/*
+	Word wordIndex of level - 1 has become empty.
+	Bit is marked in clearing word, cleared, and the word is checked again: if somebody
+		has inserted into it meanwhile, the bit is set back. Readers see marked bit as set,
+		so insert which has found the bit set before clearing is never hidden.
+	Writer who empties the word while the bit is marked leaves clearing to the marker,
+		so after unmarking the marker checks the word once more and repeats clearing
+		if the word is empty but the bit is set.
+	If summary word becomes empty too, the same is done on next level.
+*/
+inline void vEBConcurrentTree::markEmpty(int level, DataType wordIndex)
+{
+	for (; level < (int)levels.size(); ++level)
+	{
+		Word bit = Word(1) << (wordIndex & 63);
+		AtomicWord& clearingWord = clearing[level][wordIndex >> 6];
+		AtomicWord& summaryWord = levels[level][wordIndex >> 6];
+		Word old;
+		bool refilled;
+		do
+		{
+			// other writer is clearing this bit - it checks the word after us
+			if (clearingWord.fetch_or(bit) & bit)
+			{
+				return;
+			}
+			old = summaryWord.fetch_and(~bit);
+			refilled = loadWord(level - 1, wordIndex) != 0;
+			if (refilled)
+			{
+				summaryWord.fetch_or(bit);
+			}
+			clearingWord.fetch_and(~bit);
+		} while (loadWord(level - 1, wordIndex) == 0 && (summaryWord.load() & bit));
+		if (refilled || !(old & bit) || (old & ~bit) != 0)
+		{
+			return;
+		}
+		wordIndex >>= 6;
+	}
+}
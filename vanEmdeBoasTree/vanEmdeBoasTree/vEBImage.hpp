@@ -0,0 +1,437 @@
+#pragma once
+#include <cstdio>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vanEmdeBoasTree.hpp"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class vEBImageException {};
+
+/*
+	Flat read-only image of vEBTree, which can be saved to file and used right from memory
+		(for example mmapped by several processes at once, see vEBMappedImage).
+	There are no pointers in image, it is array of 64-bit words:
+		header: Magic, universeBits, keys count, levels count L, stored words count of every level;
+		level 0 - leaf bitmaps(bit per key), level l + 1 - one bit per word of level l,
+			which is not empty, level L - 1 is single word;
+		only non-empty words of every level are stored, in increasing order, and every level
+			above 0 has ranks: ranks[i] - number of set bits in stored words before i,
+			so position of child word is ranks[i] + bits of word i below child's bit.
+	So image of n keys takes about 8-16 bytes per non-empty leaf word whatever u is,
+		and contains/predecessor/successor read at most 2 words per level(L = universeBits / 6).
+	Words are in native byte order, image is not portable between different endianness.
+*/
+class vEBImage
+{
+public:
+	typedef vEBTree::DataType DataType;
+	typedef vEBOperations::Word Word;
+	static constexpr DataType InvalidValue = vEBTree::InvalidValue;
+	// "vEBIMG01" in little endian
+	static constexpr Word Magic = 0x3130474D49424576ull;
+
+	// data must be aligned to 8 bytes and must live while image is used
+	vEBImage(const void* data, size_t bytes);
+
+	//----building
+	static std::vector<Word> serialize(const vEBTree& tree);
+	static void save(const vEBTree& tree, const std::string& path);
+	//----/building
+
+	inline bool empty() const { return count == 0; }
+	inline size_t size() const { return count; }
+	inline int getUniverseBits() const { return universeBits; }
+	inline DataType getMin() const { return firstFrom(0); }
+	inline DataType getMax() const { return lastUpTo(lastKey); }
+
+	//----main methods
+	bool contains(DataType x) const;
+	DataType predecessor(DataType x) const;
+	DataType successor(DataType x) const;
+	//----/main methods
+
+private:
+	enum { HeaderWords = 4, MaxLevels = 11 };
+	static constexpr size_t NoPosition = ~size_t(0);
+	struct Level
+	{
+		const Word* words;
+		const Word* ranks;
+		size_t count;
+	};
+
+	static int levelsCount(int universeBits);
+	// index of word of x on level and index of x's bit in this word
+	static inline DataType wordIndex(DataType x, int level) { return (6 * (level + 1) >= 64) ? 0 : x >> (6 * (level + 1)); }
+	static inline int bitIndex(DataType x, int level) { return (int)((x >> (6 * level)) & 63); }
+	inline size_t childPosition(int level, size_t position, int bit) const
+	{
+		const Level& l = levels[level];
+		return (size_t)l.ranks[position] + vEBOperations::bitsCount(l.words[position] & ((Word(1) << bit) - 1));
+	}
+
+	void pathOf(DataType x, size_t* path) const;
+	DataType firstFrom(DataType x) const;
+	DataType lastUpTo(DataType x) const;
+
+	std::vector<Level> levels;
+	DataType lastKey;
+	size_t count;
+	int universeBits;
+};
+
+inline int vEBImage::levelsCount(int universeBits)
+{
+	return (universeBits <= 6) ? 1 : (universeBits + 5) / 6;
+}
+
+inline vEBImage::vEBImage(const void* data, size_t bytes)
+{
+	const Word* words = static_cast<const Word*>(data);
+	size_t wordsCount = bytes / sizeof(Word);
+	if (wordsCount < HeaderWords || words[0] != Magic || words[1] < 1 || words[1] > vEBTree::MaxUniverseBits)
+	{
+		throw vEBImageException{};
+	}
+	universeBits = (int)words[1];
+	count = (size_t)words[2];
+	int levelsNumber = levelsCount(universeBits);
+	if (words[3] != (Word)levelsNumber || wordsCount < HeaderWords + (size_t)levelsNumber)
+	{
+		throw vEBImageException{};
+	}
+	lastKey = (universeBits == vEBTree::MaxUniverseBits) ? InvalidValue - 1 : (DataType(1) << universeBits) - 1;
+	size_t offset = HeaderWords + levelsNumber;
+	for (int l = 0; l < levelsNumber; ++l)
+	{
+		Level level;
+		level.count = (size_t)words[HeaderWords + l];
+		size_t levelWords = (l == 0) ? level.count : 2 * level.count;
+		if (level.count > wordsCount || offset + levelWords > wordsCount)
+		{
+			throw vEBImageException{};
+		}
+		level.words = words + offset;
+		level.ranks = (l == 0) ? nullptr : words + offset + level.count;
+		offset += levelWords;
+		levels.push_back(level);
+	}
+	if (levels.back().count > 1)
+	{
+		throw vEBImageException{};
+	}
+}
+
+/*
+	Keys are taken with one range walk and grouped to words level by level.
+*/
+inline std::vector<vEBImage::Word> vEBImage::serialize(const vEBTree& tree)
+{
+	int levelsNumber = levelsCount(tree.getUniverseBits());
+	// indices and bits of non-empty words of every level
+	std::vector<std::vector<DataType>> indices(levelsNumber);
+	std::vector<std::vector<Word>> bits(levelsNumber);
+	size_t keys = 0;
+	if (!tree.empty())
+	{
+		tree.forEachInRange(tree.getMin(), tree.getMax(), [&](DataType key)
+		{
+			if (indices[0].empty() || indices[0].back() != (key >> 6))
+			{
+				indices[0].push_back(key >> 6);
+				bits[0].push_back(0);
+			}
+			bits[0].back() |= Word(1) << (key & 63);
+			++keys;
+		});
+	}
+	for (int l = 1; l < levelsNumber; ++l)
+	{
+		for (DataType child : indices[l - 1])
+		{
+			if (indices[l].empty() || indices[l].back() != (child >> 6))
+			{
+				indices[l].push_back(child >> 6);
+				bits[l].push_back(0);
+			}
+			bits[l].back() |= Word(1) << (child & 63);
+		}
+	}
+	std::vector<Word> image = { Magic, (Word)tree.getUniverseBits(), (Word)keys, (Word)levelsNumber };
+	for (int l = 0; l < levelsNumber; ++l)
+	{
+		image.push_back(bits[l].size());
+	}
+	for (int l = 0; l < levelsNumber; ++l)
+	{
+		image.insert(image.end(), bits[l].begin(), bits[l].end());
+		if (l > 0)
+		{
+			Word rank = 0;
+			for (Word word : bits[l])
+			{
+				image.push_back(rank);
+				rank += vEBOperations::bitsCount(word);
+			}
+		}
+	}
+	return image;
+}
+
+inline void vEBImage::save(const vEBTree& tree, const std::string& path)
+{
+	std::vector<Word> image = serialize(tree);
+	std::FILE* file = std::fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		throw vEBImageException{};
+	}
+	bool written = std::fwrite(image.data(), sizeof(Word), image.size(), file) == image.size();
+	if (std::fclose(file) != 0 || !written)
+	{
+		throw vEBImageException{};
+	}
+}
+
+/*
+	Fills path[l] with position of stored word of x on level l,
+		or NoPosition if this word is empty.
+*/
+inline void vEBImage::pathOf(DataType x, size_t* path) const
+{
+	int top = (int)levels.size() - 1;
+	path[top] = levels[top].count ? 0 : NoPosition;
+	for (int l = top - 1; l >= 0; --l)
+	{
+		size_t parent = path[l + 1];
+		int bit = bitIndex(x, l + 1);
+		path[l] = (parent != NoPosition && ((levels[l + 1].words[parent] >> bit) & 1))
+			? childPosition(l + 1, parent, bit)
+			: NoPosition;
+	}
+}
+
+inline bool vEBImage::contains(DataType x) const
+{
+	if (x > lastKey || empty())
+	{
+		return false;
+	}
+	size_t path[MaxLevels];
+	pathOf(x, path);
+	return path[0] != NoPosition && ((levels[0].words[path[0]] >> bitIndex(x, 0)) & 1);
+}
+
+inline vEBImage::DataType vEBImage::predecessor(DataType x) const
+{
+	if (x == 0)
+	{
+		return InvalidValue;
+	}
+	return lastUpTo(x > lastKey ? lastKey : x - 1);
+}
+
+inline vEBImage::DataType vEBImage::successor(DataType x) const
+{
+	if (x >= lastKey)
+	{
+		return InvalidValue;
+	}
+	return firstFrom(x + 1);
+}
+
+/*
+	Smallest key >= x.
+	Goes up along path of x until some word has bit after x's one,
+		then goes down along lowest bits.
+*/
+inline vEBImage::DataType vEBImage::firstFrom(DataType x) const
+{
+	if (x > lastKey || empty())
+	{
+		return InvalidValue;
+	}
+	size_t path[MaxLevels];
+	pathOf(x, path);
+	for (int l = 0; l < (int)levels.size(); ++l)
+	{
+		if (path[l] == NoPosition)
+		{
+			continue;
+		}
+		int bit = bitIndex(x, l);
+		// on level 0 x itself counts, on upper levels word of x is already searched
+		Word mask = (l == 0) ? (~Word(0) << bit) : (bit == 63 ? 0 : ~Word(0) << (bit + 1));
+		Word word = levels[l].words[path[l]] & mask;
+		if (!word)
+		{
+			continue;
+		}
+		size_t position = path[l];
+		int childBit = vEBOperations::lowestBit(word);
+		DataType found = (wordIndex(x, l) << 6) | childBit;
+		for (; l > 0; --l)
+		{
+			position = childPosition(l, position, childBit);
+			childBit = vEBOperations::lowestBit(levels[l - 1].words[position]);
+			found = (found << 6) | childBit;
+		}
+		return found;
+	}
+	return InvalidValue;
+}
+
+/*
+	Largest key <= x, mirror of firstFrom.
+*/
+inline vEBImage::DataType vEBImage::lastUpTo(DataType x) const
+{
+	if (empty())
+	{
+		return InvalidValue;
+	}
+	size_t path[MaxLevels];
+	pathOf(x, path);
+	for (int l = 0; l < (int)levels.size(); ++l)
+	{
+		if (path[l] == NoPosition)
+		{
+			continue;
+		}
+		int bit = bitIndex(x, l);
+		Word mask = (l == 0) ? (~Word(0) >> (63 - bit)) : ((Word(1) << bit) - 1);
+		Word word = levels[l].words[path[l]] & mask;
+		if (!word)
+		{
+			continue;
+		}
+		size_t position = path[l];
+		int childBit = vEBOperations::highestBit(word);
+		DataType found = (wordIndex(x, l) << 6) | childBit;
+		for (; l > 0; --l)
+		{
+			position = childPosition(l, position, childBit);
+			childBit = vEBOperations::highestBit(levels[l - 1].words[position]);
+			found = (found << 6) | childBit;
+		}
+		return found;
+	}
+	return InvalidValue;
+}
+
+/*
+	Image file mapped read-only to memory.
+	Nothing is read on opening: pages are loaded by OS on first access
+		and are shared by all processes which map the same file.
+*/
+class vEBMappedImage
+{
+public:
+	explicit vEBMappedImage(const std::string& path);
+	~vEBMappedImage();
+	vEBMappedImage(const vEBMappedImage&) = delete;
+	vEBMappedImage& operator=(const vEBMappedImage&) = delete;
+
+	inline const vEBImage& image() const { return *view; }
+
+private:
+	void unmap();
+
+	std::unique_ptr<vEBImage> view;
+	const void* data;
+	size_t bytes;
+#if defined(_WIN32)
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int file;
+#endif
+};
+
+inline vEBMappedImage::vEBMappedImage(const std::string& path)
+	: data{ nullptr }, bytes{ 0 }
+{
+#if defined(_WIN32)
+	mapping = NULL;
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER fileSize;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+	{
+		unmap();
+		throw vEBImageException{};
+	}
+	bytes = (size_t)fileSize.QuadPart;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+	file = open(path.c_str(), O_RDONLY);
+	struct stat fileStat;
+	if (file < 0 || fstat(file, &fileStat) != 0)
+	{
+		unmap();
+		throw vEBImageException{};
+	}
+	bytes = (size_t)fileStat.st_size;
+	void* mapped = bytes ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+	data = (mapped == MAP_FAILED) ? nullptr : mapped;
+#endif
+	if (!data)
+	{
+		unmap();
+		throw vEBImageException{};
+	}
+	try
+	{
+		view.reset(new vEBImage(data, bytes));
+	}
+	catch (...)
+	{
+		unmap();
+		throw;
+	}
+}
+
+inline vEBMappedImage::~vEBMappedImage()
+{
+	unmap();
+}
+
+inline void vEBMappedImage::unmap()
+{
+#if defined(_WIN32)
+	if (data)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data)
+	{
+		munmap(const_cast<void*>(data), bytes);
+	}
+	if (file >= 0)
+	{
+		close(file);
+	}
+	file = -1;
+#endif
+	data = nullptr;
+}
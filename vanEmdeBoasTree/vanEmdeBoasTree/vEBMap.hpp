@@ -0,0 +1,581 @@
+#pragma once
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "vanEmdeBoasTree.hpp"
+
+/*
+	Node of vEBMap - van Emde Boas tree which keeps value of every key.
+	Keys are placed as in vEBTree with Lazy storage, values are kept where keys are:
+		minimum is not stored in clusters, so its value is kept in node(minValue);
+		leaf keeps keys as bits of one word and values in array ordered by keys,
+			value of key x has index = number of keys lower than x(one popcount).
+	Summaries keep only cluster numbers, so they are ordinary vEBTree.
+	Clusters, summaries, their hash tables and value arrays are allocated from
+		memory resource of node.
+*/
+
+/*
+	Bytes taken by vEBMap(see vEBMap::memoryUsage):
+		nodeBytes - objects of all nodes,
+		valueBytes - arrays of values in leaves(with their spare capacity),
+		clusterTableBytes - hash tables of clusters(size of hash table node is estimated),
+		summaries - vEBTree summaries of all nodes.
+*/
+struct vEBMapMemoryUsage
+{
+	size_t nodes;
+	size_t nodeBytes;
+	size_t valueBytes;
+	size_t clusterTableBytes;
+	vEBMemoryUsage summaries;
+	inline size_t total() const { return nodeBytes + valueBytes + clusterTableBytes + summaries.total(); }
+};
+
+template<typename V>
+class vEBMapNode
+{
+	// clusters and summaries are freed to memory resource they were allocated from
+	template<typename T>
+	struct ResourceDeleter
+	{
+		std::pmr::memory_resource* resource;
+		void operator()(T* object) const;
+	};
+public:
+	typedef vEBTree::DataType DataType;
+	typedef std::unique_ptr<vEBMapNode<V>, ResourceDeleter<vEBMapNode<V>>> pNode;
+	static constexpr DataType InvalidValue = vEBTree::InvalidValue;
+
+	vEBMapNode(int _universeBits, std::pmr::memory_resource* _resource);
+
+	inline bool empty() const { return min == InvalidValue; }
+	inline DataType getMin() const { return min; }
+	inline DataType getMax() const { return max; }
+	// tree must not be empty
+	V* minValue();
+	V* maxValue();
+
+	V* find(DataType x);
+	// key and its value, (InvalidValue, nullptr) if there is no such key
+	std::pair<DataType, V*> predecessor(DataType x);
+	std::pair<DataType, V*> successor(DataType x);
+	bool insert(DataType x, V&& value);
+	bool erase(DataType x);
+
+	void addMemoryUsage(vEBMapMemoryUsage& usage) const;
+	void shrinkToFit();
+
+private:
+	typedef std::unique_ptr<vEBTree, ResourceDeleter<vEBTree>> pSummary;
+	template<typename T, typename... Args>
+	std::unique_ptr<T, ResourceDeleter<T>> newInResource(Args&&... args);
+
+	inline bool isLeaf() const { return universeBits <= vEBTree::LeafUniverseBits; }
+	inline DataType high(DataType x) const { return x >> lowBits; }
+	inline DataType low(DataType x) const { return x & lowMask; }
+	inline DataType index(DataType x, DataType y) const { return (x << lowBits) | y; }
+	inline size_t leafRank(DataType x) const { return vEBOperations::bitsCount(bits & ((vEBOperations::Word(1) << x) - 1)); }
+	vEBMapNode* cluster(DataType i) const;
+	vEBMapNode* clusterForInsert(DataType i);
+	void emptyTreeInsert(DataType x, V&& value);
+	void updateLeafMinMax();
+
+	pSummary summary;
+	std::pmr::unordered_map<DataType, pNode> clusters;
+	int universeBits;
+	int lowBits;
+	DataType lowMask;
+	DataType min;
+	DataType max;
+	V minKeyValue;
+	vEBOperations::Word bits;
+	std::pmr::vector<V> leafValues;
+	std::pmr::memory_resource* resource;
+};
+
+/*
+	Ordered map from keys of universe u = 2^universeBits(up to 2^64) to values.
+	Same O(lglg(u)) operations as vEBTree, and the descent which finds key
+		also finds its value, so there is no second lookup in separate hash map.
+	Memory is O(n lglg(u)) as in Lazy vEBTree.
+	V must be default constructible. Largest 64-bit key is reserved for InvalidValue.
+	All nodes, summaries and value arrays are allocated from memory resource given on
+		construction(memory which values allocate themselves is not counted).
+*/
+template<typename V>
+class vEBMap
+{
+public:
+	typedef vEBTree::DataType DataType;
+	static constexpr DataType InvalidValue = vEBTree::InvalidValue;
+
+	explicit vEBMap(int _universeBits = vEBTree::MaxUniverseBits, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+
+	inline bool empty() const { return count == 0; }
+	inline size_t size() const { return count; }
+	inline int getUniverseBits() const { return universeBits; }
+	inline DataType getMin() const { return root.getMin(); }
+	inline DataType getMax() const { return root.getMax(); }
+
+	//----main methods
+	// value of x, nullptr if there is no x
+	V* find(DataType x) { return inUniverse(x) ? root.find(x) : nullptr; }
+	bool contains(DataType x) { return find(x) != nullptr; }
+	// key and its value, (InvalidValue, nullptr) if there is no such key
+	std::pair<DataType, V*> predecessor(DataType x);
+	std::pair<DataType, V*> successor(DataType x);
+	// sets value of x, returns true if x is new key
+	bool insert(DataType x, V value);
+	bool erase(DataType x);
+	//----/main methods
+
+	vEBMapMemoryUsage memoryUsage() const;
+	// rehashes cluster tables and trims value arrays to their sizes
+	void shrinkToFit() { root.shrinkToFit(); }
+	inline std::pmr::memory_resource* getResource() const { return resource; }
+
+private:
+	inline bool inUniverse(DataType x) const { return x != InvalidValue && (universeBits == vEBTree::MaxUniverseBits || (x >> universeBits) == 0); }
+
+	vEBMapNode<V> root;
+	int universeBits;
+	size_t count;
+	std::pmr::memory_resource* resource;
+};
+
+template<typename V>
+vEBMapNode<V>::vEBMapNode(int _universeBits, std::pmr::memory_resource* _resource)
+	: summary{ nullptr, ResourceDeleter<vEBTree>{ _resource } }, clusters(_resource), universeBits{ _universeBits }, lowBits{ _universeBits / 2 },
+	lowMask{ (DataType(1) << (_universeBits / 2)) - 1 }, min{ InvalidValue }, max{ InvalidValue }, minKeyValue{}, bits{ 0 },
+	leafValues(_resource), resource{ _resource }
+{
+	if (universeBits < 1 || universeBits > vEBTree::MaxUniverseBits)
+	{
+		throw vEBTreeCreationException{};
+	}
+}
+
+template<typename V>
+template<typename T>
+void vEBMapNode<V>::ResourceDeleter<T>::operator()(T* object) const
+{
+	object->~T();
+	resource->deallocate(object, sizeof(T), alignof(T));
+}
+
+/*
+	Object of T in memory of resource of this node.
+*/
+template<typename V>
+template<typename T, typename... Args>
+std::unique_ptr<T, typename vEBMapNode<V>::template ResourceDeleter<T>> vEBMapNode<V>::newInResource(Args&&... args)
+{
+	void* memory = resource->allocate(sizeof(T), alignof(T));
+	try
+	{
+		return std::unique_ptr<T, ResourceDeleter<T>>(new (memory) T(std::forward<Args>(args)...), ResourceDeleter<T>{ resource });
+	}
+	catch (...)
+	{
+		resource->deallocate(memory, sizeof(T), alignof(T));
+		throw;
+	}
+}
+
+template<typename V>
+vEBMapNode<V>* vEBMapNode<V>::cluster(DataType i) const
+{
+	auto iter = clusters.find(i);
+	return iter == clusters.end() ? nullptr : iter->second.get();
+}
+
+template<typename V>
+vEBMapNode<V>* vEBMapNode<V>::clusterForInsert(DataType i)
+{
+	auto iter = clusters.find(i);
+	if (iter == clusters.end())
+	{
+		iter = clusters.emplace(i, newInResource<vEBMapNode<V>>(lowBits, resource)).first;
+	}
+	return iter->second.get();
+}
+
+template<typename V>
+V* vEBMapNode<V>::minValue()
+{
+	return isLeaf() ? &leafValues.front() : &minKeyValue;
+}
+
+/*
+	Maximum is stored in its cluster(if it is not minimum too),
+		so its value is found with one descent over max of clusters.
+*/
+template<typename V>
+V* vEBMapNode<V>::maxValue()
+{
+	if (isLeaf())
+	{
+		return &leafValues.back();
+	}
+	return (max == min) ? &minKeyValue : cluster(high(max))->maxValue();
+}
+
+template<typename V>
+V* vEBMapNode<V>::find(DataType x)
+{
+	if (isLeaf())
+	{
+		return ((bits >> x) & 1) ? &leafValues[leafRank(x)] : nullptr;
+	}
+	if (x == min)
+	{
+		return &minKeyValue;
+	}
+	vEBMapNode* xCluster = cluster(high(x));
+	return xCluster ? xCluster->find(low(x)) : nullptr;
+}
+
+/*
+	Same cases as vEBTree::predecessor, value is taken from the node where key is found.
+*/
+template<typename V>
+std::pair<typename vEBMapNode<V>::DataType, V*> vEBMapNode<V>::predecessor(DataType x)
+{
+	// case 1: leaf - taking highest bit lower than x
+	if (isLeaf())
+	{
+		vEBOperations::Word lower = bits & ((vEBOperations::Word(1) << x) - 1);
+		if (!lower)
+		{
+			return { InvalidValue, nullptr };
+		}
+		return { DataType(vEBOperations::highestBit(lower)), &leafValues[vEBOperations::bitsCount(lower) - 1] };
+	}
+	// case 2: x > maximum - returning maximum
+	if (max != InvalidValue && x > max)
+	{
+		return { max, maxValue() };
+	}
+	vEBMapNode* xCluster = cluster(high(x));
+	// case 3: predecessor in cluster of x
+	if (xCluster && low(x) > xCluster->getMin())
+	{
+		auto offset = xCluster->predecessor(low(x));
+		return { index(high(x), offset.first), offset.second };
+	}
+	DataType predCluster = summary ? summary->predecessor(high(x)) : InvalidValue;
+	if (predCluster == InvalidValue)
+	{
+		// case 4: predecessor is minimum(it is not stored in clusters)
+		if (min != InvalidValue && x > min)
+		{
+			return { min, &minKeyValue };
+		}
+		// case 5: not found predecessor
+		return { InvalidValue, nullptr };
+	}
+	// case 6: maximum of previous non-empty cluster
+	vEBMapNode* pred = cluster(predCluster);
+	return { index(predCluster, pred->getMax()), pred->maxValue() };
+}
+
+template<typename V>
+std::pair<typename vEBMapNode<V>::DataType, V*> vEBMapNode<V>::successor(DataType x)
+{
+	// case 1: leaf - taking lowest bit higher than x
+	if (isLeaf())
+	{
+		vEBOperations::Word higher = (x >= vEBTree::LeafUniverse - 1) ? 0 : bits & (~vEBOperations::Word(0) << (x + 1));
+		if (!higher)
+		{
+			return { InvalidValue, nullptr };
+		}
+		return { DataType(vEBOperations::lowestBit(higher)), &leafValues[leafValues.size() - vEBOperations::bitsCount(higher)] };
+	}
+	// case 2: x < minimum - returning minimum
+	if (min != InvalidValue && x < min)
+	{
+		return { min, &minKeyValue };
+	}
+	vEBMapNode* xCluster = cluster(high(x));
+	// case 3: successor in cluster of x
+	if (xCluster && low(x) < xCluster->getMax())
+	{
+		auto offset = xCluster->successor(low(x));
+		return { index(high(x), offset.first), offset.second };
+	}
+	DataType succCluster = summary ? summary->successor(high(x)) : InvalidValue;
+	// case 4: not found successor
+	if (succCluster == InvalidValue)
+	{
+		return { InvalidValue, nullptr };
+	}
+	// case 5: minimum of next non-empty cluster
+	vEBMapNode* succ = cluster(succCluster);
+	return { index(succCluster, succ->getMin()), succ->minValue() };
+}
+
+/*
+	Single pass as vEBTree::_insert, value of existing key is replaced.
+	New minimum takes place of old one, and old minimum with its value goes down to cluster.
+*/
+template<typename V>
+bool vEBMapNode<V>::insert(DataType x, V&& value)
+{
+	// case 0: leaf - setting bit and value on its place
+	if (isLeaf())
+	{
+		vEBOperations::Word mask = vEBOperations::Word(1) << x;
+		size_t rank = leafRank(x);
+		if (bits & mask)
+		{
+			leafValues[rank] = std::move(value);
+			return false;
+		}
+		leafValues.insert(leafValues.begin() + rank, std::move(value));
+		bits |= mask;
+		updateLeafMinMax();
+		return true;
+	}
+	// case 1: empty tree
+	if (empty())
+	{
+		emptyTreeInsert(x, std::move(value));
+		return true;
+	}
+	if (x == min)
+	{
+		minKeyValue = std::move(value);
+		return false;
+	}
+	// case 2: new min - swapping x with min
+	if (x < min)
+	{
+		std::swap(x, min);
+		std::swap(value, minKeyValue);
+	}
+	vEBMapNode* xCluster = clusterForInsert(high(x));
+	bool inserted = true;
+	// case 3: first element of cluster - updating summary
+	if (xCluster->empty())
+	{
+		if (!summary)
+		{
+			summary = newInResource<vEBTree>(DataType(1) << (universeBits - lowBits), vEBTree::Storage::Lazy, resource);
+		}
+		summary->insert(high(x));
+		xCluster->emptyTreeInsert(low(x), std::move(value));
+	}
+	// case 4: non-empty cluster
+	else
+	{
+		inserted = xCluster->insert(low(x), std::move(value));
+	}
+	if (x > max)
+	{
+		max = x;
+	}
+	return inserted;
+}
+
+/*
+	Single pass as vEBTree::_erase.
+	When minimum is erased, new minimum is taken out of first cluster with its value.
+*/
+template<typename V>
+bool vEBMapNode<V>::erase(DataType x)
+{
+	// case 1: leaf - clearing bit and its value
+	if (isLeaf())
+	{
+		vEBOperations::Word mask = vEBOperations::Word(1) << x;
+		if (!(bits & mask))
+		{
+			return false;
+		}
+		leafValues.erase(leafValues.begin() + leafRank(x));
+		bits &= ~mask;
+		updateLeafMinMax();
+		return true;
+	}
+	if (empty())
+	{
+		return false;
+	}
+	// case 2: only 1 element
+	if (min == max)
+	{
+		if (x != min)
+		{
+			return false;
+		}
+		min = max = InvalidValue;
+		minKeyValue = V{};
+		return true;
+	}
+	// case 3: erasing min - first key of first cluster becomes min
+	if (x == min)
+	{
+		DataType firstCluster = summary->getMin();
+		vEBMapNode* first = cluster(firstCluster);
+		x = index(firstCluster, first->getMin());
+		min = x;
+		minKeyValue = std::move(*first->minValue());
+	}
+	vEBMapNode* xCluster = cluster(high(x));
+	if (!xCluster || !xCluster->erase(low(x)))
+	{
+		return false;
+	}
+	// case 4: cluster has become empty - updating summary and max
+	if (xCluster->empty())
+	{
+		summary->erase(high(x));
+		clusters.erase(high(x));
+		if (summary->empty())
+		{
+			summary.reset();
+		}
+		if (x == max)
+		{
+			DataType summaryMax = summary ? summary->getMax() : InvalidValue;
+			max = (summaryMax == InvalidValue) ? min : index(summaryMax, cluster(summaryMax)->getMax());
+		}
+	}
+	else if (x == max)
+	{
+		max = index(high(x), xCluster->getMax());
+	}
+	return true;
+}
+
+template<typename V>
+void vEBMapNode<V>::emptyTreeInsert(DataType x, V&& value)
+{
+	if (isLeaf())
+	{
+		bits = vEBOperations::Word(1) << x;
+		leafValues.assign(1, V{});
+		leafValues[0] = std::move(value);
+	}
+	else
+	{
+		minKeyValue = std::move(value);
+	}
+	min = max = x;
+}
+
+template<typename V>
+void vEBMapNode<V>::updateLeafMinMax()
+{
+	min = bits ? vEBOperations::lowestBit(bits) : InvalidValue;
+	max = bits ? vEBOperations::highestBit(bits) : InvalidValue;
+}
+
+template<typename V>
+void vEBMapNode<V>::addMemoryUsage(vEBMapMemoryUsage& usage) const
+{
+	++usage.nodes;
+	usage.nodeBytes += sizeof(vEBMapNode<V>);
+	usage.valueBytes += leafValues.capacity() * sizeof(V);
+	usage.clusterTableBytes += clusters.bucket_count() * sizeof(void*)
+		+ clusters.size() * (sizeof(typename decltype(clusters)::value_type) + sizeof(void*));
+	if (summary)
+	{
+		vEBMemoryUsage summaryUsage = summary->memoryUsage();
+		usage.summaries.trees += summaryUsage.trees;
+		usage.summaries.treeBytes += summaryUsage.treeBytes;
+		usage.summaries.clusterTableBytes += summaryUsage.clusterTableBytes;
+	}
+	for (const auto& eachCluster : clusters)
+	{
+		eachCluster.second->addMemoryUsage(usage);
+	}
+}
+
+/*
+	Hash tables of clusters are not shrunk when clusters are erased,
+		and value arrays keep capacity of their biggest size.
+*/
+template<typename V>
+void vEBMapNode<V>::shrinkToFit()
+{
+	clusters.rehash(0);
+	leafValues.shrink_to_fit();
+	if (summary)
+	{
+		summary->shrinkToFit();
+	}
+	for (auto& eachCluster : clusters)
+	{
+		eachCluster.second->shrinkToFit();
+	}
+}
+
+template<typename V>
+vEBMap<V>::vEBMap(int _universeBits, std::pmr::memory_resource* _resource)
+	: root{ _universeBits, _resource }, universeBits{ _universeBits }, count{ 0 }, resource{ _resource }
+{
+}
+
+/*
+	Root node is part of map object, so it is counted in nodeBytes as well.
+*/
+template<typename V>
+vEBMapMemoryUsage vEBMap<V>::memoryUsage() const
+{
+	vEBMapMemoryUsage usage{ 0, 0, 0, 0, vEBMemoryUsage{ 0, 0, 0 } };
+	root.addMemoryUsage(usage);
+	return usage;
+}
+
+/*
+	Keys out of universe are not passed to nodes:
+		every key is lower than them, and none is bigger.
+*/
+template<typename V>
+std::pair<typename vEBMap<V>::DataType, V*> vEBMap<V>::predecessor(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return empty() ? std::make_pair(InvalidValue, (V*)nullptr) : std::make_pair(root.getMax(), root.maxValue());
+	}
+	return root.predecessor(x);
+}
+
+template<typename V>
+std::pair<typename vEBMap<V>::DataType, V*> vEBMap<V>::successor(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return { InvalidValue, nullptr };
+	}
+	return root.successor(x);
+}
+
+template<typename V>
+bool vEBMap<V>::insert(DataType x, V value)
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	bool inserted = root.insert(x, std::move(value));
+	count += inserted;
+	return inserted;
+}
+
+template<typename V>
+bool vEBMap<V>::erase(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	bool erased = root.erase(x);
+	count -= erased;
+	return erased;
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "vanEmdeBoasTree.hpp"
+
+/*
+	van Emde Boas tree with universe fixed at compile time: u = 2^LogU.
+	Unlike vEBTree:
+		every level is its own type vEBStaticTree<LogU / 2> or vEBStaticTree<LogU - LogU / 2>,
+			so there is no virtual call and compiler can inline the whole recursion;
+		clusters and summary are embedded by value, so the whole tree is one flat
+			block of memory(~u/8 bytes of leaf words plus min/max of inner trees);
+		levels with LogU <= 6 are single 64-bit words.
+	Big trees must be allocated on heap, for example:
+		std::unique_ptr<vEBStaticTree<24>> tree(new vEBStaticTree<24>());
+	Keys are 32-bit, so LogU must be less than 32(all ones is InvalidValue).
+*/
+template<unsigned LogU, bool Leaf = (LogU <= 6)>
+class vEBStaticTree;
+
+//---------------------------Leaf-----------------------------
+
+template<unsigned LogU>
+class vEBStaticTree<LogU, true>
+{
+public:
+	typedef std::uint32_t DataType;
+	static constexpr DataType InvalidValue = ~DataType(0);
+
+	vEBStaticTree()
+		: bits{ 0 } {}
+
+	inline bool empty() const { return bits == 0; }
+	inline DataType getMin() const { return bits ? (DataType)vEBOperations::lowestBit(bits) : InvalidValue; }
+	inline DataType getMax() const { return bits ? (DataType)vEBOperations::highestBit(bits) : InvalidValue; }
+
+	inline bool contains(DataType x) const { return (bits >> x) & 1; }
+
+	inline DataType predecessor(DataType x) const
+	{
+		vEBOperations::Word lower = bits & ((vEBOperations::Word(1) << x) - 1);
+		return lower ? (DataType)vEBOperations::highestBit(lower) : InvalidValue;
+	}
+
+	inline DataType successor(DataType x) const
+	{
+		vEBOperations::Word higher = (x >= 63) ? 0 : bits & (~vEBOperations::Word(0) << (x + 1));
+		return higher ? (DataType)vEBOperations::lowestBit(higher) : InvalidValue;
+	}
+
+	inline bool insert(DataType x)
+	{
+		vEBOperations::Word mask = vEBOperations::Word(1) << x;
+		bool had = (bits & mask) != 0;
+		bits |= mask;
+		return !had;
+	}
+
+	inline bool erase(DataType x)
+	{
+		vEBOperations::Word mask = vEBOperations::Word(1) << x;
+		bool had = (bits & mask) != 0;
+		bits &= ~mask;
+		return had;
+	}
+
+private:
+	vEBOperations::Word bits;
+};
+
+//--------------------------/Leaf-----------------------------
+
+//---------------------------Inner tree-----------------------
+
+template<unsigned LogU>
+class vEBStaticTree<LogU, false>
+{
+	static_assert(LogU < 32, "vEBStaticTree: keys are 32-bit");
+	enum : unsigned { LowBits = LogU / 2, HighBits = LogU - LogU / 2 };
+	typedef vEBStaticTree<LowBits> Cluster;
+	typedef vEBStaticTree<HighBits> Summary;
+public:
+	typedef std::uint32_t DataType;
+	static constexpr DataType InvalidValue = ~DataType(0);
+
+	vEBStaticTree()
+		: min{ InvalidValue }, max{ InvalidValue } {}
+
+	inline bool empty() const { return min == InvalidValue; }
+	inline DataType getMin() const { return min; }
+	inline DataType getMax() const { return max; }
+
+	bool contains(DataType x) const;
+	DataType predecessor(DataType x) const;
+	DataType successor(DataType x) const;
+	bool insert(DataType x);
+	bool erase(DataType x);
+
+private:
+	//----index operations
+	static inline DataType high(DataType x) { return x >> LowBits; }
+	static inline DataType low(DataType x) { return x & ((DataType(1) << LowBits) - 1); }
+	static inline DataType index(DataType x, DataType y) { return (x << LowBits) | y; }
+	//----/index operations
+
+	// as in vEBTree, min is NOT stored in clusters
+	DataType min;
+	DataType max;
+	Summary summary;
+	std::array<Cluster, (std::size_t(1) << HighBits)> clusters;
+};
+
+template<unsigned LogU>
+bool vEBStaticTree<LogU, false>::contains(DataType x) const
+{
+	if (x == min || x == max)
+	{
+		return true;
+	}
+	if (empty())
+	{
+		return false;
+	}
+	return clusters[high(x)].contains(low(x));
+}
+
+template<unsigned LogU>
+typename vEBStaticTree<LogU, false>::DataType vEBStaticTree<LogU, false>::predecessor(DataType x) const
+{
+	// case 1: x > maximum - returning maximum
+	if (max != InvalidValue && x > max)
+	{
+		return max;
+	}
+	const Cluster& xCluster = clusters[high(x)];
+	// case 2: predecessor in this subtree
+	if (!xCluster.empty() && low(x) > xCluster.getMin())
+	{
+		return index(high(x), xCluster.predecessor(low(x)));
+	}
+	DataType predCluster = summary.predecessor(high(x));
+	// case 3: predecessor in previous non-empty cluster
+	if (predCluster != Summary::InvalidValue)
+	{
+		return index(predCluster, clusters[predCluster].getMax());
+	}
+	// case 4: predecessor is minimum(not stored in clusters) or not found
+	return (min != InvalidValue && x > min) ? min : InvalidValue;
+}
+
+template<unsigned LogU>
+typename vEBStaticTree<LogU, false>::DataType vEBStaticTree<LogU, false>::successor(DataType x) const
+{
+	// case 1: x < minimum - returning minimum
+	if (min != InvalidValue && x < min)
+	{
+		return min;
+	}
+	const Cluster& xCluster = clusters[high(x)];
+	// case 2: successor in this subtree
+	if (!xCluster.empty() && low(x) < xCluster.getMax())
+	{
+		return index(high(x), xCluster.successor(low(x)));
+	}
+	DataType succCluster = summary.successor(high(x));
+	// case 3: not found successor
+	if (succCluster == Summary::InvalidValue)
+	{
+		return InvalidValue;
+	}
+	// case 4: successor in next non-empty cluster
+	return index(succCluster, clusters[succCluster].getMin());
+}
+
+/*
+	Returns false if x was already in tree.
+*/
+template<unsigned LogU>
+bool vEBStaticTree<LogU, false>::insert(DataType x)
+{
+	// case 1: empty tree
+	if (empty())
+	{
+		min = max = x;
+		return true;
+	}
+	if (x == min)
+	{
+		return false;
+	}
+	// case 2: new min - swapping x with min
+	if (x < min)
+	{
+		DataType temp = min;
+		min = x;
+		x = temp;
+	}
+	Cluster& xCluster = clusters[high(x)];
+	// case 3: first element of cluster - updating summary,
+	//		inserting to empty cluster is O(1) then
+	if (xCluster.empty())
+	{
+		summary.insert(high(x));
+	}
+	if (!xCluster.insert(low(x)))
+	{
+		return false;
+	}
+	if (x > max)
+	{
+		max = x;
+	}
+	return true;
+}
+
+/*
+	Returns false if there was no x in tree.
+*/
+template<unsigned LogU>
+bool vEBStaticTree<LogU, false>::erase(DataType x)
+{
+	if (empty())
+	{
+		return false;
+	}
+	// case 1: only 1 element in tree
+	if (min == max)
+	{
+		if (x != min)
+		{
+			return false;
+		}
+		min = max = InvalidValue;
+		return true;
+	}
+	// case 2: deleting min - next element becomes min and is erased from its cluster
+	if (x == min)
+	{
+		DataType firstCluster = summary.getMin();
+		x = index(firstCluster, clusters[firstCluster].getMin());
+		min = x;
+	}
+	Cluster& xCluster = clusters[high(x)];
+	if (!xCluster.erase(low(x)))
+	{
+		return false;
+	}
+	// case 3: cluster has become empty - updating summary and max
+	if (xCluster.empty())
+	{
+		summary.erase(high(x));
+		if (x == max)
+		{
+			DataType summaryMax = summary.getMax();
+			max = (summaryMax == Summary::InvalidValue) ? min : index(summaryMax, clusters[summaryMax].getMax());
+		}
+	}
+	// case 4: cluster is not empty - updating max
+	else if (x == max)
+	{
+		max = index(high(x), xCluster.getMax());
+	}
+	return true;
+}
+
+//--------------------------/Inner tree-----------------------
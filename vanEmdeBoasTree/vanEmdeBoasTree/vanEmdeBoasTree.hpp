@@ -1,85 +1,308 @@
-#pragma once
-#include <memory>
-#include <vector>
-#include <iostream>
-
-class vEBTreeCreationException {};
-
-namespace vEBOperations
-{
-	int upSqrt(int x);
-	int downSqrt(int x);
-
-}
-
-/*
-	Implementation of van Emde Boas tree.
-	With it we are able to to basic operations with maximum complexity of lglg(u)
-		(where u is range (0...n), where n is maximum element of tree).
-		So we must decide what u will be on creation stage.
-	Operations:
-		Minimum,
-		Maxumum,
-		Member,
-		Successor,
-		Predecessor,
-		Insert,
-		Delete.
-	We are NOT doing template classes because it has not sense:
-		van Emde Boas tree can be used only for integers.
-		Technically, it can be used with chars, but here we can just use types cast.
-*/
-
-class vEBTree
-{
-	typedef std::unique_ptr<vEBTree> pvEBTree;
-	typedef std::vector<pvEBTree> Clusters;
-public:
-	// when changing DataType, you must provide correct InvalidValue
-	// ---bounded values
-	typedef int DataType;
-	enum { InvalidValue = -1 };
-	// ---/bounded values
-
-	vEBTree(int _u);
-	vEBTree(int _u, DataType _min, DataType _max);
-
-	// empty when both elements are invalid
-	inline bool empty() const { return (min == max) && (max == InvalidValue); }
-	inline bool hasOnlyOneElement() const { return (min == max) && !empty(); }
-	inline DataType getMin() const { return min; }
-	inline DataType getMax() const { return max; }
-
-	//----main methods
-	virtual bool contains(int x);
-	virtual int predecessor(int x);
-	virtual int successor(int x);
-	virtual void insert(int x);
-	virtual void erase(int x);
-	//----/main methods
-
-protected:
-
-	inline void setMin(DataType newMin) { min = newMin; }
-	inline void setMax(DataType newMax) { max = newMax; }
-	inline int getU() const { return u; }
-
-	//----index operations
-	int high(int x);
-	int low(int x);
-	int index(int x, int y);
-	//----/index operations
-
-private:
-
-	void createSubtrees(int u);
-	void _insert(int x);
-	void _erase(int x);
-	void emptyTreeInsert(int x);
-
-	pvEBTree summary;
-	Clusters clusters;
-	int u;
-	DataType min;
-	DataType max;
-};
+#pragma once
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+class vEBTreeCreationException {};
+
+/*
+	Bytes taken by tree(see vEBTree::memoryUsage):
+		treeBytes - objects of all subtrees(clusters and summaries),
+		clusterTableBytes - arrays and hash tables of clusters(size of hash table node is estimated).
+*/
+struct vEBMemoryUsage
+{
+	size_t trees;
+	size_t treeBytes;
+	size_t clusterTableBytes;
+	inline size_t total() const { return treeBytes + clusterTableBytes; }
+};
+
+namespace vEBOperations
+{
+	int upSqrt(int x);
+	int downSqrt(int x);
+
+	// leaf trees keep their elements as bits of one word
+	typedef std::uint64_t Word;
+
+	// index of lowest/highest set bit, w must not be 0
+	inline int lowestBit(Word w)
+	{
+#if defined(_MSC_VER)
+		unsigned long i;
+		_BitScanForward64(&i, w);
+		return (int)i;
+#else
+		return __builtin_ctzll(w);
+#endif
+	}
+
+	inline int highestBit(Word w)
+	{
+#if defined(_MSC_VER)
+		unsigned long i;
+		_BitScanReverse64(&i, w);
+		return (int)i;
+#else
+		return 63 - __builtin_clzll(w);
+#endif
+	}
+
+	inline int bitsCount(Word w)
+	{
+#if defined(_MSC_VER)
+		return (int)__popcnt64(w);
+#else
+		return __builtin_popcountll(w);
+#endif
+	}
+}
+
+/*
+	Implementation of van Emde Boas tree.
+	With it we are able to to basic operations with maximum complexity of lglg(u)
+		(where u is range (0...n), where n is maximum element of tree).
+		So we must decide what u will be on creation stage.
+	Clusters can be stored in two ways(see Storage):
+		Eager - all clusters and summaries are created in constructor, memory is O(u);
+		Lazy - cluster(or summary) is created on first insert to it and freed
+			when it becomes empty, clusters are stored in hash table by high(x),
+			so memory is O(n lglg(u)) whatever u is.
+	Recursion stops at u <= LeafUniverse: such leaf tree keeps its elements as bits
+		of one 64-bit word and answers queries with bit scans instead of going deeper.
+	Operations:
+		Minimum,
+		Maxumum,
+		Member,
+		Successor,
+		Predecessor,
+		Insert,
+		Delete.
+	We are NOT doing template classes because it has not sense:
+		van Emde Boas tree can be used only for integers.
+		Keys are 64-bit unsigned, so any narrower unsigned key can be used with types cast,
+		and u can be up to 2^64(see withUniverseBits). Largest 64-bit key is reserved
+		for InvalidValue(matters only when u = 2^64).
+		For big universes Lazy storage should be used.
+	All subtrees and cluster tables are allocated from memory resource given on
+		construction(default one is new/delete), so tree can be put into its own arena.
+*/
+
+class vEBTree
+{
+	// subtrees are freed to memory resource they were allocated from
+	struct SubtreeDeleter
+	{
+		std::pmr::memory_resource* resource;
+		void operator()(vEBTree* tree) const;
+	};
+	typedef std::unique_ptr<vEBTree, SubtreeDeleter> pvEBTree;
+	typedef std::pmr::vector<pvEBTree> Clusters;
+public:
+	// when changing DataType, you must provide correct InvalidValue
+	// ---bounded values
+	typedef std::uint64_t DataType;
+	static constexpr DataType InvalidValue = ~DataType(0);
+	// ---/bounded values
+private:
+	typedef std::pmr::unordered_map<DataType, pvEBTree> HashedClusters;
+public:
+
+	enum { LeafUniverse = 64, LeafUniverseBits = 6, MaxUniverseBits = 64 };
+
+	enum class Storage { Eager, Lazy };
+
+	vEBTree(DataType _u, Storage _storage = Storage::Eager, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	vEBTree(DataType _u, DataType _min, DataType _max, Storage _storage = Storage::Eager,
+		std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	static vEBTree withUniverseBits(int universeBits, Storage _storage = Storage::Eager,
+		std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	//----bulk building
+	template<typename InputIt>
+	static vEBTree fromSorted(DataType _u, InputIt first, InputIt last, Storage _storage = Storage::Eager,
+		std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	static vEBTree fromBitmap(DataType _u, const std::vector<vEBOperations::Word>& bitmap, Storage _storage = Storage::Eager,
+		std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+	template<typename InputIt> void assignSorted(InputIt first, InputIt last);
+	void clear();
+	//----/bulk building
+
+	// empty when both elements are invalid
+	inline bool empty() const { return (min == max) && (max == InvalidValue); }
+	inline bool hasOnlyOneElement() const { return (min == max) && !empty(); }
+	inline DataType getMin() const { return min; }
+	inline DataType getMax() const { return max; }
+	inline Storage getStorage() const { return storage; }
+	inline int getUniverseBits() const { return universeBits; }
+	inline std::pmr::memory_resource* getResource() const { return resource; }
+
+	//----main methods
+	virtual bool contains(DataType x);
+	virtual DataType predecessor(DataType x);
+	virtual DataType successor(DataType x);
+	virtual bool insert(DataType x);
+	virtual bool erase(DataType x);
+	//----batch methods(return number of keys which changed membership)
+	template<typename InputIt> size_t insert(InputIt first, InputIt last);
+	template<typename InputIt> size_t erase(InputIt first, InputIt last);
+	//----/main methods
+
+	//----range methods(both bounds are included)
+	template<typename Function> void forEachInRange(DataType lo, DataType hi, Function f) const;
+	size_t countInRange(DataType lo, DataType hi) const;
+	//----/range methods
+
+	//----set algebra(trees must have equal universes)
+	static vEBTree unite(const vEBTree& a, const vEBTree& b);
+	static vEBTree intersect(const vEBTree& a, const vEBTree& b);
+	//----/set algebra
+
+	//----memory
+	// visits all subtrees, so it is O(u) for Eager storage
+	vEBMemoryUsage memoryUsage() const;
+	void shrinkToFit();
+	//----/memory
+
+protected:
+
+	inline void setMin(DataType newMin) { min = newMin; }
+	inline void setMax(DataType newMax) { max = newMax; }
+	// not valid for u = 2^64(use getUniverseBits)
+	inline DataType getU() const { return DataType(1) << universeBits; }
+	inline bool isLeaf() const { return universeBits <= LeafUniverseBits; }
+	inline bool inUniverse(DataType x) const { return universeBits == MaxUniverseBits || (x >> universeBits) == 0; }
+
+	//----index operations
+	// index of subtree
+	inline DataType high(DataType x) const { return x >> lowBits; }
+	// index of cluster in subtree
+	inline DataType low(DataType x) const { return x & lowMask; }
+	// restore index
+	inline DataType index(DataType x, DataType y) const { return (x << lowBits) | y; }
+	//----/index operations
+
+private:
+
+	// tag for constructing by universe bits instead of universe size
+	struct UniverseBits { int bits; };
+	vEBTree(UniverseBits _universeBits, DataType _min, DataType _max, Storage _storage, std::pmr::memory_resource* _resource);
+	static int universeBitsOf(DataType _u);
+
+	pvEBTree newSubtree(int subtreeBits);
+	void addMemoryUsage(vEBMemoryUsage& usage) const;
+	void createSubtrees();
+	void initIndexOperations();
+	vEBTree* cluster(DataType i) const;
+	vEBTree* clusterForInsert(DataType i);
+	vEBTree* summaryForInsert();
+	void releaseEmptyCluster(DataType i);
+	bool _insert(DataType x);
+	bool _erase(DataType x);
+	void emptyTreeInsert(DataType x);
+	void updateLeafMinMax();
+	void buildSorted(const DataType* keys, size_t n);
+
+	// gets keys {base + i : bit i of word is set}
+	typedef void (*WordVisitor)(void* context, DataType base, vEBOperations::Word word);
+	struct ClusterVisit;
+	void visitRange(DataType lo, DataType hi, DataType offset, WordVisitor visit, void* context) const;
+	static void visitClusters(void* context, DataType base, vEBOperations::Word word);
+	std::vector<DataType> keysOf() const;
+
+	pvEBTree summary;
+	Clusters clusters;
+	HashedClusters hashedClusters;
+	Storage storage;
+	int universeBits;
+	int lowBits;
+	DataType lowMask;
+	DataType min;
+	DataType max;
+	vEBOperations::Word bits;
+	std::pmr::memory_resource* resource;
+};
+
+template<typename InputIt>
+size_t vEBTree::insert(InputIt first, InputIt last)
+{
+	size_t inserted = 0;
+	for (; first != last; ++first)
+	{
+		inserted += insert(static_cast<DataType>(*first));
+	}
+	return inserted;
+}
+
+template<typename InputIt>
+size_t vEBTree::erase(InputIt first, InputIt last)
+{
+	size_t erased = 0;
+	for (; first != last; ++first)
+	{
+		erased += erase(static_cast<DataType>(*first));
+	}
+	return erased;
+}
+
+template<typename InputIt>
+vEBTree vEBTree::fromSorted(DataType _u, InputIt first, InputIt last, Storage _storage, std::pmr::memory_resource* _resource)
+{
+	vEBTree tree(_u, _storage, _resource);
+	tree.assignSorted(first, last);
+	return tree;
+}
+
+/*
+	Replaces contents of tree with keys from non-decreasing sequence.
+	Tree is built bottom-up in one pass, without inserting keys one by one.
+	Key out of universe or smaller than previous one throws vEBTreeCreationException,
+		tree is not changed then.
+*/
+template<typename InputIt>
+void vEBTree::assignSorted(InputIt first, InputIt last)
+{
+	std::vector<DataType> keys;
+	for (; first != last; ++first)
+	{
+		DataType key = static_cast<DataType>(*first);
+		if (key == InvalidValue || (!keys.empty() && keys.back() == key))
+		{
+			continue;
+		}
+		if (!inUniverse(key) || (!keys.empty() && key < keys.back()))
+		{
+			throw vEBTreeCreationException{};
+		}
+		keys.push_back(key);
+	}
+	clear();
+	buildSorted(keys.data(), keys.size());
+}
+
+/*
+	Walks over leaves and cluster minimums of range once,
+		without looking for every next key from root.
+*/
+template<typename Function>
+void vEBTree::forEachInRange(DataType lo, DataType hi, Function f) const
+{
+	visitRange(lo, hi, 0, [](void* context, DataType base, vEBOperations::Word word)
+	{
+		Function& visit = *static_cast<Function*>(context);
+		while (word)
+		{
+			visit(base + vEBOperations::lowestBit(word));
+			word &= word - 1;
+		}
+	}, &f);
+}
+
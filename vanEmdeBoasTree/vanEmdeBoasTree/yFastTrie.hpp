@@ -0,0 +1,409 @@
+#pragma once
+#include <iterator>
+#include <memory_resource>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "vanEmdeBoasTree.hpp"
+
+/*
+	y-fast trie - successor set for sparse sets over big universes u = 2^universeBits(up to 2^64).
+	Same contains/predecessor/successor/insert/erase as vEBTree, but memory is O(n), not O(u).
+	Keys are split to buckets - balanced BSTs(std::set) with about universeBits keys.
+		Every bucket has representative rep and keeps keys from (previous rep, rep],
+		last representative is always u - 1, so every key has its bucket.
+	Representatives are kept in x-fast trie:
+		levels[l] - hash table of all l-bit prefixes of representatives with min and max
+			representative under this prefix;
+		links - representatives in sorted doubly linked list.
+	Bucket of x is found with binary search over prefix lengths: O(log log u) hash lookups,
+		then O(log log u) for search in bucket.
+	Buckets are split when they grow to 2 * universeBits keys and merged with next one
+		when they shrink below universeBits / 2, so x-fast trie is changed(O(log u)) only
+		once per O(log u) insert/erase.
+	All hash tables and buckets are allocated from memory resource given on construction.
+*/
+
+/*
+	Bytes taken by yFastTrie(sizes of hash table and tree nodes are estimated):
+		trieBytes - prefix tables of all levels and linked list of representatives,
+		bucketBytes - table of buckets and keys in them.
+*/
+struct yFastTrieMemoryUsage
+{
+	size_t representatives;
+	size_t trieBytes;
+	size_t bucketBytes;
+	inline size_t total() const { return trieBytes + bucketBytes; }
+};
+
+class yFastTrie
+{
+public:
+	typedef vEBTree::DataType DataType;
+	static constexpr DataType InvalidValue = vEBTree::InvalidValue;
+
+	explicit yFastTrie(int _universeBits = vEBTree::MaxUniverseBits, std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+
+	inline bool empty() const { return count == 0; }
+	inline size_t size() const { return count; }
+	inline int getUniverseBits() const { return universeBits; }
+	DataType getMin() const;
+	DataType getMax() const;
+
+	//----main methods
+	bool contains(DataType x) const;
+	DataType predecessor(DataType x) const;
+	DataType successor(DataType x) const;
+	bool insert(DataType x);
+	bool erase(DataType x);
+	//----/main methods
+
+	yFastTrieMemoryUsage memoryUsage() const;
+	// rehashes all tables to their sizes(they are not shrunk when keys are erased)
+	void shrinkToFit();
+	inline std::pmr::memory_resource* getResource() const { return resource; }
+
+private:
+	typedef std::pmr::set<DataType> Bucket;
+	struct PrefixNode
+	{
+		DataType minRep;
+		DataType maxRep;
+	};
+	struct Link
+	{
+		DataType prev;
+		DataType next;
+	};
+
+	inline bool inUniverse(DataType x) const { return x <= lastKey; }
+	inline DataType prefix(DataType x, int length) const { return length == 0 ? 0 : x >> (universeBits - length); }
+
+	//----x-fast trie over representatives
+	DataType ceilRep(DataType x) const;
+	void insertRep(DataType rep);
+	void eraseRep(DataType rep);
+	//----/x-fast trie over representatives
+
+	void splitBucket(DataType rep);
+	void mergeBucket(DataType rep);
+	template<typename Table>
+	static size_t tableBytes(const Table& table);
+
+	std::pmr::vector<std::pmr::unordered_map<DataType, PrefixNode>> levels;
+	std::pmr::unordered_map<DataType, Link> links;
+	std::pmr::unordered_map<DataType, Bucket> buckets;
+	// biggest key of universe, also representative of last bucket
+	DataType lastKey;
+	int universeBits;
+	size_t count;
+	size_t maxBucket;
+	size_t minBucket;
+	std::pmr::memory_resource* resource;
+};
+
+inline yFastTrie::yFastTrie(int _universeBits, std::pmr::memory_resource* _resource)
+	: levels(_resource), links(_resource), buckets(_resource), universeBits{ _universeBits }, count{ 0 }, resource{ _resource }
+{
+	if (universeBits < 1 || universeBits > vEBTree::MaxUniverseBits)
+	{
+		throw vEBTreeCreationException{};
+	}
+	// with 64 bits all ones is InvalidValue, so it can not be a key
+	lastKey = (universeBits == vEBTree::MaxUniverseBits) ? InvalidValue - 1 : (DataType(1) << universeBits) - 1;
+	maxBucket = 2 * universeBits;
+	minBucket = (universeBits / 2 > 0) ? universeBits / 2 : 1;
+	levels.resize(universeBits + 1);
+	links[lastKey] = Link{ InvalidValue, InvalidValue };
+	for (int l = 0; l <= universeBits; ++l)
+	{
+		levels[l][prefix(lastKey, l)] = PrefixNode{ lastKey, lastKey };
+	}
+	buckets[lastKey];
+}
+
+inline yFastTrie::DataType yFastTrie::getMin() const
+{
+	if (empty())
+	{
+		return InvalidValue;
+	}
+	// first bucket is never empty unless it is the last one
+	return *buckets.at(levels[0].at(0).minRep).begin();
+}
+
+inline yFastTrie::DataType yFastTrie::getMax() const
+{
+	if (empty())
+	{
+		return InvalidValue;
+	}
+	const Bucket& last = buckets.at(lastKey);
+	return last.empty() ? *buckets.at(links.at(lastKey).prev).rbegin() : *last.rbegin();
+}
+
+/*
+	Smallest representative >= x.
+	Longest prefix of x which exists in trie is found with binary search over levels,
+		then next bit of x tells which side of x all representatives under this prefix are.
+*/
+inline yFastTrie::DataType yFastTrie::ceilRep(DataType x) const
+{
+	int lo = 0;
+	int hi = universeBits;
+	// levels[lo] always has prefix of x(level 0 has root)
+	while (lo < hi)
+	{
+		int mid = (lo + hi + 1) / 2;
+		if (levels[mid].count(prefix(x, mid)))
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid - 1;
+		}
+	}
+	if (lo == universeBits)
+	{
+		return x;
+	}
+	const PrefixNode& node = levels[lo].at(prefix(x, lo));
+	bool nextBit = (x >> (universeBits - lo - 1)) & 1;
+	// no child on 0 side - every representative under prefix is bigger than x
+	if (!nextBit)
+	{
+		return node.minRep;
+	}
+	return links.at(node.maxRep).next;
+}
+
+inline void yFastTrie::insertRep(DataType rep)
+{
+	// rep is never bigger than lastKey, which is always representative
+	DataType next = ceilRep(rep);
+	DataType prev = links[next].prev;
+	links[rep] = Link{ prev, next };
+	links[next].prev = rep;
+	if (prev != InvalidValue)
+	{
+		links[prev].next = rep;
+	}
+	for (int l = 0; l <= universeBits; ++l)
+	{
+		auto inserted = levels[l].emplace(prefix(rep, l), PrefixNode{ rep, rep });
+		if (!inserted.second)
+		{
+			PrefixNode& node = inserted.first->second;
+			if (rep < node.minRep)
+			{
+				node.minRep = rep;
+			}
+			if (rep > node.maxRep)
+			{
+				node.maxRep = rep;
+			}
+		}
+	}
+}
+
+/*
+	Representatives under one prefix are neighbours in linked list,
+		so removed min/max is replaced with its next/previous one.
+*/
+inline void yFastTrie::eraseRep(DataType rep)
+{
+	Link link = links.at(rep);
+	links.erase(rep);
+	if (link.prev != InvalidValue)
+	{
+		links[link.prev].next = link.next;
+	}
+	links[link.next].prev = link.prev;
+	for (int l = universeBits; l >= 0; --l)
+	{
+		auto iter = levels[l].find(prefix(rep, l));
+		PrefixNode& node = iter->second;
+		if (node.minRep == rep && node.maxRep == rep)
+		{
+			levels[l].erase(iter);
+			continue;
+		}
+		if (node.minRep == rep)
+		{
+			node.minRep = link.next;
+		}
+		if (node.maxRep == rep)
+		{
+			node.maxRep = link.prev;
+		}
+	}
+}
+
+inline bool yFastTrie::contains(DataType x) const
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	return buckets.at(ceilRep(x)).count(x) != 0;
+}
+
+inline yFastTrie::DataType yFastTrie::predecessor(DataType x) const
+{
+	if (x == 0 || empty())
+	{
+		return InvalidValue;
+	}
+	if (!inUniverse(x))
+	{
+		return getMax();
+	}
+	DataType rep = ceilRep(x);
+	const Bucket& bucket = buckets.at(rep);
+	auto iter = bucket.lower_bound(x);
+	// case 1: predecessor in bucket of x
+	if (iter != bucket.begin())
+	{
+		return *--iter;
+	}
+	// case 2: maximum of previous bucket(only last bucket can be empty)
+	DataType prevRep = links.at(rep).prev;
+	return (prevRep == InvalidValue) ? InvalidValue : *buckets.at(prevRep).rbegin();
+}
+
+inline yFastTrie::DataType yFastTrie::successor(DataType x) const
+{
+	if (x >= lastKey || empty())
+	{
+		return InvalidValue;
+	}
+	DataType rep = ceilRep(x);
+	const Bucket& bucket = buckets.at(rep);
+	auto iter = bucket.upper_bound(x);
+	// case 1: successor in bucket of x
+	if (iter != bucket.end())
+	{
+		return *iter;
+	}
+	// case 2: minimum of next bucket
+	DataType nextRep = links.at(rep).next;
+	if (nextRep == InvalidValue)
+	{
+		return InvalidValue;
+	}
+	const Bucket& next = buckets.at(nextRep);
+	return next.empty() ? InvalidValue : *next.begin();
+}
+
+/*
+	Returns false if x was already in trie(or is out of universe).
+*/
+inline bool yFastTrie::insert(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	DataType rep = ceilRep(x);
+	Bucket& bucket = buckets.at(rep);
+	if (!bucket.insert(x).second)
+	{
+		return false;
+	}
+	++count;
+	if (bucket.size() >= maxBucket)
+	{
+		splitBucket(rep);
+	}
+	return true;
+}
+
+/*
+	Returns false if there was no x in trie.
+*/
+inline bool yFastTrie::erase(DataType x)
+{
+	if (!inUniverse(x))
+	{
+		return false;
+	}
+	DataType rep = ceilRep(x);
+	Bucket& bucket = buckets.at(rep);
+	if (!bucket.erase(x))
+	{
+		return false;
+	}
+	--count;
+	// last bucket has no next one and may be even empty
+	if (rep != lastKey && bucket.size() < minBucket)
+	{
+		mergeBucket(rep);
+	}
+	return true;
+}
+
+/*
+	Lower half of bucket goes to new bucket, its maximum becomes new representative.
+*/
+inline void yFastTrie::splitBucket(DataType rep)
+{
+	Bucket& bucket = buckets.at(rep);
+	auto middle = bucket.begin();
+	std::advance(middle, bucket.size() / 2);
+	Bucket lower(bucket.begin(), middle, resource);
+	bucket.erase(bucket.begin(), middle);
+	DataType newRep = *lower.rbegin();
+	buckets.emplace(newRep, std::move(lower));
+	insertRep(newRep);
+}
+
+/*
+	Keys of small bucket are moved to next bucket, which range is extended down,
+		so representative of small bucket disappears.
+*/
+inline void yFastTrie::mergeBucket(DataType rep)
+{
+	DataType nextRep = links.at(rep).next;
+	Bucket& next = buckets.at(nextRep);
+	Bucket& small = buckets.at(rep);
+	next.insert(small.begin(), small.end());
+	buckets.erase(rep);
+	eraseRep(rep);
+	if (next.size() >= maxBucket)
+	{
+		splitBucket(nextRep);
+	}
+}
+
+// hash table node is estimated as value with pointer to next node
+template<typename Table>
+size_t yFastTrie::tableBytes(const Table& table)
+{
+	return table.bucket_count() * sizeof(void*) + table.size() * (sizeof(typename Table::value_type) + sizeof(void*));
+}
+
+/*
+	Bucket key is estimated as red-black tree node: value, parent, two children and color.
+*/
+inline yFastTrieMemoryUsage yFastTrie::memoryUsage() const
+{
+	yFastTrieMemoryUsage usage{ links.size(), levels.capacity() * sizeof(levels[0]) + tableBytes(links), tableBytes(buckets) };
+	for (const auto& level : levels)
+	{
+		usage.trieBytes += tableBytes(level);
+	}
+	usage.bucketBytes += count * (sizeof(DataType) + 4 * sizeof(void*));
+	return usage;
+}
+
+inline void yFastTrie::shrinkToFit()
+{
+	for (auto& level : levels)
+	{
+		level.rehash(0);
+	}
+	links.rehash(0);
+	buckets.rehash(0);
+}